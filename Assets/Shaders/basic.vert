@@ -2,27 +2,35 @@
 
 layout(binding = 0) uniform CameraData
 {
-	mat4 Model;
 	mat4 View;
 	mat4 Projection;
 } u_CameraUniforms;
 
+// This frame's region of the object ring, selected with a dynamic offset
+layout(std430, binding = 3) readonly buffer Transforms { mat4 Data[]; } b_Transforms;
+
 layout(location = 0) in vec3 a_Position;
 layout(location = 1) in vec4 a_Color;
 layout(location = 2) in vec2 a_TexCoord;
 layout(location = 3) in vec3 a_Normal;
+// Per instance
+layout(location = 4) in uint a_ObjectIndex;
 
 layout(location = 0) out vec4 v_FragColor;
 layout(location = 1) out vec2 v_TexCoord;
 layout(location = 2) out vec3 v_Normal;
 layout(location = 3) out vec3 v_Position;
 
+// Matches the depth prepass, see depth.vert
+invariant gl_Position;
+
 void main() 
 {
-    gl_Position = u_CameraUniforms.Projection * (u_CameraUniforms.View * (u_CameraUniforms.Model * vec4(a_Position, 1.0)));
+	mat4 model = b_Transforms.Data[a_ObjectIndex];
+    gl_Position = u_CameraUniforms.Projection * (u_CameraUniforms.View * (model * vec4(a_Position, 1.0)));
     
 	v_FragColor = a_Color;
 	v_TexCoord = a_TexCoord;
-	v_Normal = mat3(transpose(inverse(u_CameraUniforms.Model))) * a_Normal;
-	v_Position = (u_CameraUniforms.Model * vec4(a_Position, 1.0)).xyz;
+	v_Normal = mat3(transpose(inverse(model))) * a_Normal;
+	v_Position = (model * vec4(a_Position, 1.0)).xyz;
 }
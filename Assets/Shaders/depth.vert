@@ -0,0 +1,24 @@
+#version 450
+
+layout(binding = 0) uniform CameraData
+{
+	mat4 View;
+	mat4 Projection;
+} u_CameraUniforms;
+
+// This frame's region of the object ring, selected with a dynamic offset
+layout(std430, binding = 3) readonly buffer Transforms { mat4 Data[]; } b_Transforms;
+
+// Only the position is fetched: the pipeline has no fragment stage
+layout(location = 0) in vec3 a_Position;
+// Per instance
+layout(location = 4) in uint a_ObjectIndex;
+
+// The geometry pass tests against this depth with VK_COMPARE_OP_EQUAL: positions must match basic.vert bit for bit
+invariant gl_Position;
+
+void main() 
+{
+	mat4 model = b_Transforms.Data[a_ObjectIndex];
+	gl_Position = u_CameraUniforms.Projection * (u_CameraUniforms.View * (model * vec4(a_Position, 1.0)));
+}
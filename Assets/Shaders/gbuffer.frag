@@ -0,0 +1,28 @@
+#version 450
+
+layout(location = 0) in vec4 v_FragColor;
+layout(location = 1) in vec2 v_TexCoord;
+layout(location = 2) in vec3 v_Normal;
+layout(location = 3) in vec3 v_Position;
+
+// G-buffer: only surface properties are written here, lighting.frag shades every pixel once
+layout(location = 0) out vec4 OutAlbedo;
+layout(location = 1) out vec4 OutNormal;
+layout(location = 2) out vec4 OutMaterial;
+
+layout(binding = 1) uniform sampler2D u_Texture;
+
+layout(push_constant) uniform Consts
+{
+	float Metallic;
+	float Roughness;
+	float AO;
+} u_PushConsts;
+
+void main() 
+{
+	OutAlbedo = vec4(texture(u_Texture, v_TexCoord).rgb, 1.0);
+	// Stored in [0, 1], the target is unsigned
+	OutNormal = vec4(normalize(v_Normal) * 0.5 + 0.5, 0.0);
+	OutMaterial = vec4(u_PushConsts.Metallic, u_PushConsts.Roughness, u_PushConsts.AO, 0.0);
+}
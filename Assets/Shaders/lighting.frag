@@ -0,0 +1,159 @@
+#version 450
+
+layout(location = 0) in vec2 v_TexCoord;
+
+layout(location = 0) out vec4 OutColor;
+
+// G-buffer written by gbuffer.frag
+layout(binding = 0) uniform sampler2D u_Albedo;
+layout(binding = 1) uniform sampler2D u_Normal;
+layout(binding = 2) uniform sampler2D u_Material;
+layout(binding = 3) uniform sampler2D u_Depth;
+
+layout(push_constant) uniform Consts
+{
+	mat4 InverseViewProjection;
+	vec4 CameraPosition;
+} u_PushConsts;
+
+// Lights binned by cluster.comp
+const uint MAX_LIGHTS_PER_CLUSTER = 128;
+
+layout(std140, binding = 4) uniform ClusterData
+{
+	mat4 InverseProjection;
+	mat4 View;
+	vec2 ScreenSize;
+	float Near;
+	float Far;
+	uvec4 GridSize;
+} u_Clusters;
+
+struct PointLight
+{
+	// xyz position, w radius
+	vec4 PositionRadius;
+	vec4 Color;
+};
+
+layout(std430, binding = 5) readonly buffer Lights { PointLight Data[]; } b_Lights;
+layout(std430, binding = 6) readonly buffer ClusterCounts { uint Data[]; } b_Counts;
+layout(std430, binding = 7) readonly buffer ClusterIndices { uint Data[]; } b_Indices;
+
+const float PI = 3.14159265359;
+
+float DistributionGGX(vec3 N, vec3 H, float roughness)
+{
+    float a      = roughness*roughness;
+    float a2     = a*a;
+    float NdotH  = max(dot(N, H), 0.0);
+    float NdotH2 = NdotH*NdotH;
+	
+    float num   = a2;
+    float denom = (NdotH2 * (a2 - 1.0) + 1.0);
+    denom = PI * denom * denom;
+	
+    return num / denom;
+}
+
+float GeometrySchlickGGX(float NdotV, float roughness)
+{
+    float r = (roughness + 1.0);
+    float k = (r*r) / 8.0;
+
+    float num   = NdotV;
+    float denom = NdotV * (1.0 - k) + k;
+	
+    return num / denom;
+}
+float GeometrySmith(vec3 N, vec3 V, vec3 L, float roughness)
+{
+    float NdotV = max(dot(N, V), 0.0);
+    float NdotL = max(dot(N, L), 0.0);
+    float ggx2  = GeometrySchlickGGX(NdotV, roughness);
+    float ggx1  = GeometrySchlickGGX(NdotL, roughness);
+	
+    return ggx1 * ggx2;
+}
+vec3 fresnelSchlick(float cosTheta, vec3 F0)
+{
+    return F0 + (1.0 - F0) * pow(clamp(1.0 - cosTheta, 0.0, 1.0), 5.0);
+}  
+
+void main() 
+{
+	float depth = texture(u_Depth, v_TexCoord).r;
+	// Nothing was drawn here
+	if (depth >= 1.0)
+	{
+		OutColor = vec4(0.0, 0.0, 0.0, 1.0);
+		return;
+	}
+
+	// World position from the depth buffer
+	vec4 world = u_PushConsts.InverseViewProjection * vec4(v_TexCoord * 2.0 - 1.0, depth, 1.0);
+	vec3 position = world.xyz / world.w;
+
+	vec3 albedo = texture(u_Albedo, v_TexCoord).rgb;
+	vec3 material = texture(u_Material, v_TexCoord).rgb;
+	float metallic = material.r;
+	float roughness = material.g;
+	float ao = material.b;
+
+	vec3 N = normalize(texture(u_Normal, v_TexCoord).xyz * 2.0 - 1.0);
+    vec3 V = normalize(u_PushConsts.CameraPosition.xyz - position);
+
+	// Same slicing as cluster.comp
+	uvec3 grid = u_Clusters.GridSize.xyz;
+	float viewDepth = -(u_Clusters.View * vec4(position, 1.0)).z;
+	uint slice = uint(max(log(viewDepth / u_Clusters.Near) / log(u_Clusters.Far / u_Clusters.Near) * float(grid.z), 0.0));
+	uvec2 tile = uvec2(gl_FragCoord.xy / u_Clusters.ScreenSize * vec2(grid.xy));
+	tile = min(tile, grid.xy - 1u);
+	uint cluster = tile.x + tile.y * grid.x + min(slice, grid.z - 1u) * grid.x * grid.y;
+	uint lightCount = b_Counts.Data[cluster];
+
+    vec3 F0 = vec3(0.04); 
+    F0 = mix(F0, albedo, metallic);
+	
+    // reflectance equation
+    vec3 Lo = vec3(0.0);
+    for(uint i = 0; i < lightCount; i++) 
+    {
+        PointLight light = b_Lights.Data[b_Indices.Data[cluster * MAX_LIGHTS_PER_CLUSTER + i]];
+        vec3 lightPosition = light.PositionRadius.xyz;
+
+        // calculate per-light radiance
+        vec3 L = normalize(lightPosition - position);
+        vec3 H = normalize(V + L);
+        float distance    = length(lightPosition - position);
+        // Smoothly reaches zero at the radius, past which the light wasn't binned
+        float window      = clamp(1.0 - pow(distance / light.PositionRadius.w, 4.0), 0.0, 1.0);
+        float attenuation = window * window / (distance);
+        vec3 radiance     = light.Color.rgb * attenuation;        
+        
+        // cook-torrance brdf
+        float NDF = DistributionGGX(N, H, roughness);
+        float G   = GeometrySmith(N, V, L, roughness);
+        vec3 F    = fresnelSchlick(max(dot(H, V), 0.0), F0);
+        
+        vec3 kS = F;
+        vec3 kD = vec3(1.0) - kS;
+        kD *= 1.0 - metallic;	  
+        
+        vec3 numerator    = NDF * G * F;
+        float denominator = 4.0 * max(dot(N, V), 0.0) * max(dot(N, L), 0.0) + 0.0001;
+        vec3 specular     = numerator / denominator;  
+            
+        // add to outgoing radiance Lo
+        float NdotL = max(dot(N, L), 0.0);                
+        Lo += (kD * albedo / PI + specular) * radiance * NdotL; 
+    }   
+  
+    vec3 ambient = vec3(0.03) * albedo * ao;
+    vec3 color = ambient + Lo;
+	
+    color = color / (color + vec3(1.0));
+    color = pow(color, vec3(1.0/2.2));  
+   
+    OutColor = vec4(color, 1.0);
+}
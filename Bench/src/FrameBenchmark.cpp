@@ -0,0 +1,220 @@
+#include <FrameBenchmark.h>
+#include <Renderer.h>
+#include <Resources/Camera.h>
+#include <Resources/Mesh.h>
+#include <Resources/MaterialInstance.h>
+#include <Vulkan/Command/ImmediateCommands.h>
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <chrono>
+#include <random>
+#include <iostream>
+#include <iomanip>
+
+#ifdef _WIN32
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+using namespace Low;
+
+namespace Bench
+{
+	struct FrameSample
+	{
+		double FrameTime;
+		RendererStats Stats;
+	};
+
+	// Peak resident memory of the process, in megabytes
+	static double PeakMemory()
+	{
+#ifdef _WIN32
+		PROCESS_MEMORY_COUNTERS counters;
+		GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters));
+		return counters.PeakWorkingSetSize / (1024.0 * 1024.0);
+#else
+		rusage usage;
+		getrusage(RUSAGE_SELF, &usage);
+		return usage.ru_maxrss / 1024.0;
+#endif
+	}
+
+	static std::vector<glm::mat4> GenerateTransforms(uint32_t count, std::mt19937& rng)
+	{
+		// Spread in a box around the camera's target, wider than the frustum so that part of the scene gets culled
+		std::uniform_real_distribution<float> position(-60.0f, 60.0f);
+		std::uniform_real_distribution<float> depth(-150.0f, 0.0f);
+		std::uniform_real_distribution<float> scale(0.25f, 1.0f);
+
+		std::vector<glm::mat4> ret(count);
+		for (uint32_t i = 0; i < count; i++)
+		{
+			glm::mat4 transform = glm::translate(glm::mat4(1.0f), glm::vec3(position(rng), position(rng), depth(rng)));
+			ret[i] = glm::scale(transform, glm::vec3(scale(rng)));
+		}
+
+		return ret;
+	}
+
+	static std::vector<PointLight> GenerateLights(uint32_t count, std::mt19937& rng)
+	{
+		// Same volume as the renderables
+		std::uniform_real_distribution<float> position(-60.0f, 60.0f);
+		std::uniform_real_distribution<float> depth(-150.0f, 0.0f);
+		std::uniform_real_distribution<float> color(1.0f, 20.0f);
+		std::uniform_real_distribution<float> radius(5.0f, 20.0f);
+
+		std::vector<PointLight> ret(count);
+		for (uint32_t i = 0; i < count; i++)
+			ret[i] = { glm::vec3(position(rng), position(rng), depth(rng)), glm::vec3(color(rng), color(rng), color(rng)), radius(rng) };
+
+		return ret;
+	}
+
+	static double AverageFragmentInvocations(const std::vector<FrameSample>& samples)
+	{
+		double invocations = 0;
+		for (auto& sample : samples)
+			invocations += sample.Stats.FragmentInvocations;
+
+		return invocations / samples.size();
+	}
+
+	// baselineInvocations: fragment invocations of the same scene without the depth prepass, negative if it wasn't measured
+	static void PrintSummary(uint32_t renderables, const std::vector<FrameSample>& samples, double baselineInvocations, bool last)
+	{
+		double frameTime = 0, optimize = 0, prepare = 0, draw = 0, gpu = 0, draws = 0, visible = 0, triangles = 0;
+		std::vector<double> frameTimes;
+
+		for (auto& sample : samples)
+		{
+			frameTime += sample.FrameTime;
+			optimize += sample.Stats.OptimizeTime;
+			prepare += sample.Stats.PrepareTime;
+			draw += sample.Stats.DrawTime;
+			gpu += sample.Stats.GpuTime;
+			draws += sample.Stats.DrawCalls;
+			visible += sample.Stats.VisibleRenderables;
+			triangles += sample.Stats.Triangles;
+			frameTimes.push_back(sample.FrameTime);
+		}
+
+		double count = samples.size();
+		std::sort(frameTimes.begin(), frameTimes.end());
+
+		std::cout << std::fixed << std::setprecision(3);
+		std::cout << "    {" << std::endl;
+		std::cout << "      \"renderables\": " << renderables << "," << std::endl;
+		std::cout << "      \"frames\": " << samples.size() << "," << std::endl;
+		std::cout << "      \"frame_ms\": " << frameTime / count << "," << std::endl;
+		std::cout << "      \"frame_ms_p50\": " << frameTimes[frameTimes.size() / 2] << "," << std::endl;
+		std::cout << "      \"frame_ms_p99\": " << frameTimes[(frameTimes.size() * 99) / 100] << "," << std::endl;
+		std::cout << "      \"optimize_ms\": " << optimize / count << "," << std::endl;
+		std::cout << "      \"prepare_ms\": " << prepare / count << "," << std::endl;
+		std::cout << "      \"draw_ms\": " << draw / count << "," << std::endl;
+		std::cout << "      \"gpu_ms\": " << gpu / count << "," << std::endl;
+		std::cout << "      \"visible\": " << visible / count << "," << std::endl;
+		std::cout << "      \"draw_calls\": " << draws / count << "," << std::endl;
+		std::cout << "      \"triangles\": " << triangles / count << "," << std::endl;
+		std::cout << "      \"draws_per_second\": " << draws / (frameTime / 1000.0) << "," << std::endl;
+		std::cout << "      \"fragment_invocations\": " << AverageFragmentInvocations(samples) << "," << std::endl;
+		if (baselineInvocations >= 0)
+			std::cout << "      \"saved_fragment_invocations\": " << baselineInvocations - AverageFragmentInvocations(samples) << "," << std::endl;
+		std::cout << "      \"peak_memory_mb\": " << PeakMemory() << std::endl;
+		std::cout << "    }" << (last ? "" : ",") << std::endl;
+	}
+
+	void RunFrameBenchmark(bool gpuDriven, uint32_t lightCount, bool depthPrepass, bool occlusion)
+	{
+		const uint32_t counts[] = { 1000, 10000, 100000 };
+		const uint32_t meshCount = 16;
+		const uint32_t materialCount = 64;
+		const uint32_t warmupFrames = 30;
+		const uint32_t frames = 300;
+
+		// The debug messenger is always set up, its extension is the only one a headless instance needs
+		std::vector<const char*> extensions = { "VK_EXT_debug_utils" };
+
+		RendererConfig config;
+		config.Extensions = extensions.data();
+		config.ExtensionCount = extensions.size();
+		config.MaxFramesInFlight = 2;
+		config.GpuDriven = gpuDriven;
+		config.OcclusionCulling = occlusion;
+		config.Headless = true;
+		Renderer::Init(config, nullptr);
+
+		// Distinct meshes and materials, so that the scene is split in batches and instanced draws like a real one
+		std::vector<Ref<Mesh>> meshes;
+		std::vector<Ref<MaterialInstance>> materials;
+		ImmediateCommands::BeginBatch();
+		for (uint32_t i = 0; i < meshCount; i++)
+			meshes.push_back(CreateRef<Mesh>("../../Assets/Models/Sphere/sphere.obj"));
+		ImmediateCommands::EndBatch();
+		for (uint32_t i = 0; i < materialCount; i++)
+			materials.push_back(CreateRef<MaterialInstance>());
+
+		Camera camera(glm::lookAt(glm::vec3(0.0f, 0.0f, 10.0f), glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f)),
+			glm::perspective(glm::radians(45.0f), (float)config.HeadlessWidth / config.HeadlessHeight, 0.1f, 200.0f));
+
+		std::mt19937 rng(42);
+		std::vector<PointLight> lights = GenerateLights(lightCount, rng);
+
+		std::cout << "{" << std::endl;
+		std::cout << "  \"benchmark\": \"frame\"," << std::endl;
+		std::cout << "  \"gpu_driven\": " << (gpuDriven ? "true" : "false") << "," << std::endl;
+		std::cout << "  \"lights\": " << lightCount << "," << std::endl;
+		std::cout << "  \"depth_prepass\": " << (depthPrepass ? "true" : "false") << "," << std::endl;
+		std::cout << "  \"occlusion_culling\": " << (occlusion ? "true" : "false") << "," << std::endl;
+		std::cout << "  \"width\": " << config.HeadlessWidth << "," << std::endl;
+		std::cout << "  \"height\": " << config.HeadlessHeight << "," << std::endl;
+		std::cout << "  \"scenes\": [" << std::endl;
+
+		for (uint32_t c = 0; c < std::size(counts); c++)
+		{
+			uint32_t count = counts[c];
+			std::vector<glm::mat4> transforms = GenerateTransforms(count, rng);
+
+			auto renderScene = [&](bool prepass)
+			{
+				// Toggled between scenes: the warmup frames also cover the latency of the statistics
+				Renderer::SetDepthPrepass(prepass);
+				std::vector<FrameSample> samples;
+
+				for (uint32_t frame = 0; frame < warmupFrames + frames; frame++)
+				{
+					auto start = std::chrono::high_resolution_clock::now();
+
+					Renderer::Begin(camera);
+					for (auto& light : lights)
+						Renderer::PushLight(light);
+					for (uint32_t i = 0; i < count; i++)
+						Renderer::PushModel(meshes[i % meshCount], materials[(i / meshCount) % materialCount], transforms[i]);
+					Renderer::End();
+
+					auto end = std::chrono::high_resolution_clock::now();
+
+					if (frame >= warmupFrames)
+						samples.push_back({ std::chrono::duration<double, std::milli>(end - start).count(), Renderer::Stats() });
+				}
+
+				return samples;
+			};
+
+			// The savings of the prepass are measured against the same scene rendered without it
+			double baselineInvocations = depthPrepass ? AverageFragmentInvocations(renderScene(false)) : -1.0;
+			std::vector<FrameSample> samples = renderScene(depthPrepass);
+
+			PrintSummary(count, samples, baselineInvocations, c == std::size(counts) - 1);
+		}
+
+		std::cout << "  ]" << std::endl;
+		std::cout << "}" << std::endl;
+
+		Renderer::Destroy();
+	}
+}
@@ -0,0 +1,10 @@
+#pragma once
+
+namespace Bench
+{
+	// Renders procedural scenes of increasing size with a headless renderer and prints per-stage timings as JSON. The scenes
+	// are lit by lightCount point lights scattered among the renderables. With depthPrepass, every scene is also rendered
+	// without the prepass first, to report how many fragment invocations it saved. occlusion enables the Hi-Z occlusion
+	// culling of the GPU driven path
+	void RunFrameBenchmark(bool gpuDriven, uint32_t lightCount = 1, bool depthPrepass = false, bool occlusion = false);
+}
@@ -0,0 +1,41 @@
+#include <SortBenchmark.h>
+#include <FrameBenchmark.h>
+
+#include <iostream>
+#include <string>
+
+int main(int argc, char** argv)
+{
+    std::string benchmark = argc > 1 ? argv[1] : "sort";
+
+    if (benchmark == "sort")
+        Bench::RunSortBenchmark();
+    else if (benchmark == "frame")
+    {
+        bool gpuDriven = false;
+        uint32_t lights = 1;
+        bool depthPrepass = false;
+        bool occlusion = false;
+        for (int i = 2; i < argc; i++)
+        {
+            std::string arg = argv[i];
+            if (arg == "--gpu-driven")
+                gpuDriven = true;
+            else if (arg == "--lights" && i + 1 < argc)
+                lights = std::stoul(argv[++i]);
+            else if (arg == "--depth-prepass")
+                depthPrepass = true;
+            else if (arg == "--occlusion")
+                occlusion = true;
+        }
+
+        Bench::RunFrameBenchmark(gpuDriven, lights, depthPrepass, occlusion);
+    }
+    else
+    {
+        std::cerr << "Unknown benchmark " << benchmark << ". Available: sort, frame [--gpu-driven] [--lights N] [--depth-prepass] [--occlusion]" << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
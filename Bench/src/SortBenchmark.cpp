@@ -0,0 +1,66 @@
+#include <SortBenchmark.h>
+#include <Rendering/DrawSorter.h>
+
+#include <chrono>
+#include <random>
+#include <iostream>
+#include <iomanip>
+
+using namespace Low;
+
+namespace Bench
+{
+	static std::vector<DrawItem> GenerateDrawList(uint32_t count, std::mt19937& rng)
+	{
+		// Plausible scene: a few pipelines, hundreds of materials, a thousand meshes, depths within a kilometer
+		std::uniform_int_distribution<uint32_t> pipeline(0, 3);
+		std::uniform_int_distribution<uint32_t> material(0, 511);
+		std::uniform_int_distribution<uint32_t> mesh(0, 1023);
+		std::uniform_real_distribution<float> depth(0.1f, 1000.0f);
+
+		std::vector<DrawItem> ret(count);
+		for (uint32_t i = 0; i < count; i++)
+			ret[i] = { DrawSorter::MakeKey(DrawPass::Opaque, pipeline(rng), material(rng), mesh(rng), 0, depth(rng)), 0, i };
+
+		return ret;
+	}
+
+	void RunSortBenchmark()
+	{
+		const uint32_t counts[] = { 10000, 100000, 1000000 };
+		const uint32_t iterations = 25;
+
+		std::mt19937 rng(42);
+		DrawSorter sorter;
+
+		std::cout << std::setw(10) << "draws" << std::setw(12) << "min ms" << std::setw(12) << "median ms" << std::setw(14) << "Mdraws/s" << std::endl;
+
+		for (uint32_t count : counts)
+		{
+			std::vector<DrawItem> source = GenerateDrawList(count, rng);
+			std::vector<DrawItem> items;
+			std::vector<double> times;
+
+			// Warm up the scratch buffer so its allocation isn't measured
+			items = source;
+			sorter.Sort(items);
+
+			for (uint32_t i = 0; i < iterations; i++)
+			{
+				items = source;
+
+				auto start = std::chrono::high_resolution_clock::now();
+				sorter.Sort(items);
+				auto end = std::chrono::high_resolution_clock::now();
+
+				times.push_back(std::chrono::duration<double, std::milli>(end - start).count());
+			}
+
+			std::sort(times.begin(), times.end());
+			double median = times[times.size() / 2];
+
+			std::cout << std::setw(10) << count << std::fixed << std::setprecision(3) << std::setw(12) << times[0] << std::setw(12) << median <<
+				std::setw(14) << (count / 1000000.0) / (median / 1000.0) << std::endl;
+		}
+	}
+}
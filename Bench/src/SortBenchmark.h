@@ -0,0 +1,7 @@
+#pragma once
+
+namespace Bench
+{
+	// Measures DrawSorter::Sort on randomized draw lists of increasing size
+	void RunSortBenchmark();
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <condition_variable>
+#include <mutex>
+
+namespace Low
+{
+	// Fixed capacity queue between a producer and a consumer thread. Push blocks while the queue is full and Pop while it's
+	// empty, so the producer can never get more than Capacity elements ahead of the consumer
+	template <typename T>
+	class BoundedQueue
+	{
+	public:
+		BoundedQueue(uint32_t capacity) : m_Capacity(capacity) {}
+
+		// Returns false if the queue has been closed
+		bool Push(T value)
+		{
+			std::unique_lock<std::mutex> lock(m_Mutex);
+			m_NotFull.wait(lock, [&]() { return m_Closed || m_Items.size() < m_Capacity; });
+			if (m_Closed)
+				return false;
+
+			m_Items.push_back(std::move(value));
+			lock.unlock();
+			m_NotEmpty.notify_one();
+			return true;
+		}
+
+		// Returns false once the queue has been closed and there's nothing left to pop
+		bool Pop(T& value)
+		{
+			std::unique_lock<std::mutex> lock(m_Mutex);
+			m_NotEmpty.wait(lock, [&]() { return m_Closed || !m_Items.empty(); });
+			if (m_Items.empty())
+				return false;
+
+			value = std::move(m_Items.front());
+			m_Items.pop_front();
+			lock.unlock();
+			m_NotFull.notify_one();
+			return true;
+		}
+
+		// Wakes up both sides: pushes fail from now on, pops drain what's left
+		void Close()
+		{
+			{
+				std::lock_guard<std::mutex> lock(m_Mutex);
+				m_Closed = true;
+			}
+			m_NotFull.notify_all();
+			m_NotEmpty.notify_all();
+		}
+
+	private:
+		std::deque<T> m_Items;
+		uint32_t m_Capacity;
+		bool m_Closed = false;
+
+		std::mutex m_Mutex;
+		std::condition_variable m_NotFull;
+		std::condition_variable m_NotEmpty;
+	};
+}
@@ -1,5 +1,9 @@
 #pragma once
 
+// Expands the arguments before pasting them, so that LOW_CONCAT(name, __LINE__) gives the line number
+#define LOW_CONCAT_IMPL(a, b) a##b
+#define LOW_CONCAT(a, b) LOW_CONCAT_IMPL(a, b)
+
 namespace Low
 {
 	template <typename T>
@@ -0,0 +1,191 @@
+#include <Core/GpuProfiler.h>
+
+#include <Vulkan/VulkanCore.h>
+#include <Vulkan/Command/ImmediateCommands.h>
+#include <Hardware/Support.h>
+
+namespace Low
+{
+	bool GpuProfiler::s_Supported = false;
+
+	struct GpuScope
+	{
+		std::string Name;
+		uint32_t BeginQuery;
+		uint32_t EndQuery;
+	};
+
+	struct GpuProfilerState
+	{
+		VkQueryPool QueryPool = VK_NULL_HANDLE;
+		uint32_t QueriesPerFrame = 0;
+		float TimestampPeriod = 0.0f;
+		uint64_t TimestampMask = 0;
+		// Microseconds to add to a GPU time to get the matching high_resolution_clock time
+		double CpuOffset = 0.0;
+
+		// Per frame in flight: scopes recorded the last time the frame was started
+		std::vector<std::vector<GpuScope>> Scopes;
+		std::vector<uint32_t> UsedQueries;
+
+		uint32_t CurrentFrame = 0;
+		std::vector<uint32_t> OpenScopes;
+
+		std::unordered_map<std::string, float> Times;
+		std::vector<uint64_t> Results;
+	} s_ProfilerState;
+
+	static double TicksToMicroseconds(uint64_t ticks)
+	{
+		return ticks * (double)s_ProfilerState.TimestampPeriod / 1000.0;
+	}
+
+	static long long CpuMicroseconds()
+	{
+		// Same clock as the CPU scopes of the Instrumentor
+		return std::chrono::time_point_cast<std::chrono::microseconds>(std::chrono::high_resolution_clock::now()).time_since_epoch().count();
+	}
+
+	static void Calibrate()
+	{
+		// Write a timestamp and read the CPU clock as soon as it has been executed. The error is the latency of the wait,
+		// small compared to the length of the passes
+		VkCommandBuffer commandBuffer = ImmediateCommands::Begin();
+		vkCmdResetQueryPool(commandBuffer, s_ProfilerState.QueryPool, 0, 1);
+		vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, s_ProfilerState.QueryPool, 0);
+		ImmediateCommands::End(commandBuffer);
+		long long cpuTime = CpuMicroseconds();
+
+		uint64_t timestamp;
+		vkGetQueryPoolResults(VulkanCore::Device(), s_ProfilerState.QueryPool, 0, 1, sizeof(uint64_t), &timestamp, sizeof(uint64_t),
+			VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WAIT_BIT);
+
+		s_ProfilerState.CpuOffset = cpuTime - TicksToMicroseconds(timestamp & s_ProfilerState.TimestampMask);
+	}
+
+	void GpuProfiler::Init(uint32_t framesInFlight, uint32_t maxScopesPerFrame)
+	{
+		uint32_t graphicsFamily = Support::GetQueueFamilyIndices(VulkanCore::PhysicalDevice(), VulkanCore::Surface()).Graphics.value();
+
+		uint32_t familyCount;
+		vkGetPhysicalDeviceQueueFamilyProperties(VulkanCore::PhysicalDevice(), &familyCount, nullptr);
+		std::vector<VkQueueFamilyProperties> families(familyCount);
+		vkGetPhysicalDeviceQueueFamilyProperties(VulkanCore::PhysicalDevice(), &familyCount, families.data());
+
+		uint32_t validBits = families[graphicsFamily].timestampValidBits;
+		if (validBits == 0)
+		{
+			std::cerr << "The graphics queue doesn't support timestamps, GPU profiling is disabled" << std::endl;
+			return;
+		}
+
+		VkPhysicalDeviceProperties properties;
+		vkGetPhysicalDeviceProperties(VulkanCore::PhysicalDevice(), &properties);
+
+		s_ProfilerState.QueriesPerFrame = maxScopesPerFrame * 2;
+		s_ProfilerState.TimestampPeriod = properties.limits.timestampPeriod;
+		s_ProfilerState.TimestampMask = validBits >= 64 ? UINT64_MAX : ((uint64_t)1 << validBits) - 1;
+		s_ProfilerState.Scopes.resize(framesInFlight);
+		s_ProfilerState.UsedQueries.resize(framesInFlight, 0);
+		s_ProfilerState.Results.resize(s_ProfilerState.QueriesPerFrame);
+
+		VkQueryPoolCreateInfo poolInfo = {};
+		poolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+		poolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+		poolInfo.queryCount = s_ProfilerState.QueriesPerFrame * framesInFlight;
+
+		if (vkCreateQueryPool(VulkanCore::Device(), &poolInfo, nullptr, &s_ProfilerState.QueryPool) != VK_SUCCESS)
+			throw std::runtime_error("Couldn't create timestamp query pool");
+
+		s_Supported = true;
+		Calibrate();
+	}
+
+	void GpuProfiler::Shutdown()
+	{
+		if (s_ProfilerState.QueryPool != VK_NULL_HANDLE)
+			vkDestroyQueryPool(VulkanCore::Device(), s_ProfilerState.QueryPool, nullptr);
+
+		s_ProfilerState = {};
+		s_Supported = false;
+	}
+
+	void GpuProfiler::BeginFrame(VkCommandBuffer commandBuffer, uint32_t frame)
+	{
+		if (!s_Supported)
+			return;
+
+		uint32_t firstQuery = frame * s_ProfilerState.QueriesPerFrame;
+		uint32_t usedQueries = s_ProfilerState.UsedQueries[frame];
+
+		// The frame's timeline value has been waited: everything it wrote is available
+		if (usedQueries > 0 && vkGetQueryPoolResults(VulkanCore::Device(), s_ProfilerState.QueryPool, firstQuery, usedQueries,
+			usedQueries * sizeof(uint64_t), s_ProfilerState.Results.data(), sizeof(uint64_t), VK_QUERY_RESULT_64_BIT) == VK_SUCCESS)
+		{
+			bool tracing = Instrumentor::Get().Active();
+
+			for (auto& scope : s_ProfilerState.Scopes[frame])
+			{
+				uint64_t begin = s_ProfilerState.Results[scope.BeginQuery - firstQuery] & s_ProfilerState.TimestampMask;
+				uint64_t end = s_ProfilerState.Results[scope.EndQuery - firstQuery] & s_ProfilerState.TimestampMask;
+				uint64_t elapsed = (end - begin) & s_ProfilerState.TimestampMask;
+
+				s_ProfilerState.Times[scope.Name] = TicksToMicroseconds(elapsed) / 1000.0;
+
+				if (tracing)
+				{
+					long long start = (long long)(TicksToMicroseconds(begin) + s_ProfilerState.CpuOffset);
+					Instrumentor::Get().WriteProfile({ scope.Name, start, start + (long long)TicksToMicroseconds(elapsed), 0, ProfileTrack::GPU });
+				}
+			}
+		}
+
+		s_ProfilerState.CurrentFrame = frame;
+		s_ProfilerState.Scopes[frame].clear();
+		s_ProfilerState.UsedQueries[frame] = 0;
+		s_ProfilerState.OpenScopes.clear();
+		vkCmdResetQueryPool(commandBuffer, s_ProfilerState.QueryPool, firstQuery, s_ProfilerState.QueriesPerFrame);
+	}
+
+	void GpuProfiler::BeginScope(VkCommandBuffer commandBuffer, const std::string& name)
+	{
+		if (!s_Supported)
+			return;
+
+		uint32_t frame = s_ProfilerState.CurrentFrame;
+		if (s_ProfilerState.UsedQueries[frame] + 2 > s_ProfilerState.QueriesPerFrame)
+		{
+			// Still push the scope, so that the matching EndScope has something to pop
+			s_ProfilerState.OpenScopes.push_back(UINT32_MAX);
+			return;
+		}
+
+		uint32_t query = frame * s_ProfilerState.QueriesPerFrame + s_ProfilerState.UsedQueries[frame];
+		s_ProfilerState.UsedQueries[frame] += 2;
+
+		vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, s_ProfilerState.QueryPool, query);
+
+		s_ProfilerState.OpenScopes.push_back(s_ProfilerState.Scopes[frame].size());
+		s_ProfilerState.Scopes[frame].push_back({ name, query, query + 1 });
+	}
+
+	void GpuProfiler::EndScope(VkCommandBuffer commandBuffer)
+	{
+		if (!s_Supported || s_ProfilerState.OpenScopes.empty())
+			return;
+
+		uint32_t scope = s_ProfilerState.OpenScopes.back();
+		s_ProfilerState.OpenScopes.pop_back();
+		if (scope == UINT32_MAX)
+			return;
+
+		uint32_t frame = s_ProfilerState.CurrentFrame;
+		vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, s_ProfilerState.QueryPool, s_ProfilerState.Scopes[frame][scope].EndQuery);
+	}
+
+	float GpuProfiler::ScopeTime(const std::string& name)
+	{
+		auto it = s_ProfilerState.Times.find(name);
+		return it != s_ProfilerState.Times.end() ? it->second : 0.0f;
+	}
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+namespace Low
+{
+	// GPU timings of named scopes, bracketed with timestamps written in a query range per frame in flight. The results of a
+	// frame are read the next time the frame is started, after its timeline value has been waited, so reading them never stalls.
+	// Scopes are also written to the Instrumentor session, on the GPU track
+	class GpuProfiler
+	{
+	public:
+		// Does nothing if the graphics queue can't write timestamps, scopes are ignored then
+		static void Init(uint32_t framesInFlight, uint32_t maxScopesPerFrame = 64);
+		static void Shutdown();
+
+		// Must be recorded first in the frame's command buffer, once the frame's timeline value has been waited: collects the results
+		// of the previous use of the frame's queries and resets them
+		static void BeginFrame(VkCommandBuffer commandBuffer, uint32_t frame);
+
+		// Scopes can be nested but not recorded in secondary command buffers
+		static void BeginScope(VkCommandBuffer commandBuffer, const std::string& name);
+		static void EndScope(VkCommandBuffer commandBuffer);
+
+		// Milliseconds spent in the scope the last time its results were read, 0 if it has never been read
+		static float ScopeTime(const std::string& name);
+
+		inline static bool Supported() { return s_Supported; }
+
+	private:
+		static bool s_Supported;
+	};
+
+	class GpuProfileScope
+	{
+	public:
+		GpuProfileScope(VkCommandBuffer commandBuffer, const std::string& name) : m_CommandBuffer(commandBuffer)
+		{
+			GpuProfiler::BeginScope(commandBuffer, name);
+		}
+
+		~GpuProfileScope()
+		{
+			GpuProfiler::EndScope(m_CommandBuffer);
+		}
+
+	private:
+		VkCommandBuffer m_CommandBuffer;
+	};
+}
+
+#ifdef LOW_PROFILE
+	#define LOW_PROFILE_GPU_SCOPE(commandBuffer, name) ::Low::GpuProfileScope LOW_CONCAT(gpuTimer, __LINE__)(commandBuffer, name);
+#else
+	#define LOW_PROFILE_GPU_SCOPE(commandBuffer, name)
+#endif
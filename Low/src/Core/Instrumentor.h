@@ -4,15 +4,20 @@
 
 #include <fstream>
 #include <chrono>
+#include <mutex>
 #include <thread>
 
 namespace Low
 {
+    // Trace processes: CPU scopes and GPU scopes are shown as separate tracks
+    enum class ProfileTrack : uint32_t { CPU = 0, GPU };
+
     struct ProfileResult
     {
         std::string Name;
         long long Start, End;
         size_t ThreadID;
+        ProfileTrack Track = ProfileTrack::CPU;
     };
 
     struct InstrumentationSession
@@ -26,6 +31,8 @@ namespace Low
         InstrumentationSession* m_CurrentSession;
         std::ofstream m_OutputStream;
         int m_ProfileCount;
+        // Scopes are written by the main thread, the render thread and the workers
+        std::mutex m_Mutex;
     public:
         Instrumentor()
             : m_CurrentSession(nullptr), m_ProfileCount(0)
@@ -34,6 +41,7 @@ namespace Low
 
         void BeginSession(const std::string& name, const std::string& filepath = "results.json")
         {
+            std::lock_guard<std::mutex> lock(m_Mutex);
             m_OutputStream.open(filepath);
             m_ProfileCount = 0;
             WriteHeader();
@@ -42,6 +50,7 @@ namespace Low
 
         void EndSession()
         {
+            std::lock_guard<std::mutex> lock(m_Mutex);
             WriteFooter();
             m_OutputStream.close();
             delete m_CurrentSession;
@@ -49,8 +58,14 @@ namespace Low
             m_ProfileCount = 0;
         }
 
+        inline bool Active() { return m_CurrentSession != nullptr; }
+
         void WriteProfile(const ProfileResult& result)
         {
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            if (!m_CurrentSession)
+                return;
+
             if (m_ProfileCount++ > 0)
                 m_OutputStream << ",";
 
@@ -62,7 +77,7 @@ namespace Low
             m_OutputStream << "\"dur\":" << (result.End - result.Start) << ',';
             m_OutputStream << "\"name\":\"" << name << "\",";
             m_OutputStream << "\"ph\":\"X\",";
-            m_OutputStream << "\"pid\":0,";
+            m_OutputStream << "\"pid\":" << (uint32_t)result.Track << ",";
             m_OutputStream << "\"tid\":" << result.ThreadID << ",";
             m_OutputStream << "\"ts\":" << result.Start;
             m_OutputStream << "}";
@@ -73,6 +88,10 @@ namespace Low
         inline void WriteHeader()
         {
             m_OutputStream << "{\"otherData\": {},\"traceEvents\":[";
+            // Name the tracks
+            m_OutputStream << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":0,\"args\":{\"name\":\"CPU\"}},";
+            m_OutputStream << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\"GPU\"}}";
+            m_ProfileCount = 2;
             m_OutputStream.flush();
         }
 
@@ -127,7 +146,7 @@ namespace Low
 #ifdef LOW_PROFILE
     #define LOW_PROFILE_BEGIN_SESSION(name, filepath) ::Low::Instrumentor::Get().BeginSession(name,filepath)
     #define LOW_PROFILE_END_SESSION() ::Low::Instrumentor::Get().EndSession()
-    #define LOW_PROFILE_SCOPE(name) ::Low::InstrumentationTimer timer##__LINE__(name);
+    #define LOW_PROFILE_SCOPE(name) ::Low::InstrumentationTimer LOW_CONCAT(timer, __LINE__)(name);
     #define LOW_PROFILE_FUNCTION() LOW_PROFILE_SCOPE(__FUNCSIG__)
 #else
     #define LOW_PROFILE_BEGIN_SESSION(name, filepath)
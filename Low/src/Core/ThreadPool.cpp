@@ -0,0 +1,148 @@
+#include <Core/ThreadPool.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+namespace Low
+{
+	struct ThreadPoolState
+	{
+		std::vector<std::thread> Workers;
+		bool Running = false;
+
+		std::mutex Mutex;
+		std::mutex DispatchMutex;
+		std::condition_variable WorkAvailable;
+		std::condition_variable WorkDone;
+
+		// Current job
+		const ParallelForFunction* Function = nullptr;
+		uint32_t Count = 0;
+		uint32_t ChunkSize = 0;
+		uint64_t Generation = 0;
+		// Workers inside RunChunks. The next job is only published once they've all left, so that a late worker can't
+		// claim a chunk of it with the previous job's counters
+		uint32_t ActiveWorkers = 0;
+
+		std::atomic<uint32_t> ChunkCount = 0;
+		std::atomic<uint32_t> NextChunk = 0;
+		std::atomic<uint32_t> DoneChunks = 0;
+	} s_PoolState;
+
+	static void RunChunks()
+	{
+		uint32_t chunk;
+		while ((chunk = s_PoolState.NextChunk.fetch_add(1)) < s_PoolState.ChunkCount)
+		{
+			uint32_t begin = std::min(chunk * s_PoolState.ChunkSize, s_PoolState.Count);
+			uint32_t end = std::min(begin + s_PoolState.ChunkSize, s_PoolState.Count);
+			(*s_PoolState.Function)(chunk, begin, end);
+
+			if (s_PoolState.DoneChunks.fetch_add(1) + 1 == s_PoolState.ChunkCount)
+			{
+				std::lock_guard<std::mutex> lock(s_PoolState.Mutex);
+				s_PoolState.WorkDone.notify_all();
+			}
+		}
+	}
+
+	static void WorkerLoop()
+	{
+		uint64_t lastGeneration = 0;
+
+		while (true)
+		{
+			{
+				std::unique_lock<std::mutex> lock(s_PoolState.Mutex);
+				s_PoolState.WorkAvailable.wait(lock, [&]() { return !s_PoolState.Running || s_PoolState.Generation != lastGeneration; });
+
+				if (!s_PoolState.Running)
+					return;
+				lastGeneration = s_PoolState.Generation;
+				s_PoolState.ActiveWorkers++;
+			}
+
+			RunChunks();
+
+			std::lock_guard<std::mutex> lock(s_PoolState.Mutex);
+			if (--s_PoolState.ActiveWorkers == 0)
+				s_PoolState.WorkDone.notify_all();
+		}
+	}
+
+	void ThreadPool::Init(uint32_t threadCount)
+	{
+		if (threadCount == 0)
+			threadCount = std::max(std::thread::hardware_concurrency(), 1u);
+
+		s_PoolState.Running = true;
+		for (uint32_t i = 0; i < threadCount - 1; i++)
+			s_PoolState.Workers.emplace_back(WorkerLoop);
+	}
+
+	void ThreadPool::Shutdown()
+	{
+		{
+			std::lock_guard<std::mutex> lock(s_PoolState.Mutex);
+			s_PoolState.Running = false;
+		}
+		s_PoolState.WorkAvailable.notify_all();
+
+		for (auto& worker : s_PoolState.Workers)
+			worker.join();
+		s_PoolState.Workers.clear();
+	}
+
+	uint32_t ThreadPool::ThreadCount()
+	{
+		return s_PoolState.Workers.size() + 1;
+	}
+
+	uint32_t ThreadPool::ChunkCount(uint32_t count, uint32_t minChunkSize)
+	{
+		if (count == 0)
+			return 0;
+
+		// A few chunks per thread balance the load when some chunks are slower than others
+		uint32_t maxChunks = (count + minChunkSize - 1) / std::max(minChunkSize, 1u);
+		return std::max(std::min(maxChunks, ThreadCount() * 4), 1u);
+	}
+
+	void ThreadPool::ParallelFor(uint32_t count, uint32_t minChunkSize, const ParallelForFunction& function)
+	{
+		uint32_t chunkCount = ChunkCount(count, minChunkSize);
+		if (chunkCount == 0)
+			return;
+
+		// Not worth waking up the workers
+		if (chunkCount == 1 || s_PoolState.Workers.empty())
+		{
+			uint32_t chunkSize = (count + chunkCount - 1) / chunkCount;
+			for (uint32_t i = 0; i < chunkCount; i++)
+				function(i, std::min(i * chunkSize, count), std::min((i + 1) * chunkSize, count));
+			return;
+		}
+
+		std::lock_guard<std::mutex> dispatchLock(s_PoolState.DispatchMutex);
+		{
+			std::unique_lock<std::mutex> lock(s_PoolState.Mutex);
+			s_PoolState.WorkDone.wait(lock, [&]() { return s_PoolState.ActiveWorkers == 0; });
+
+			s_PoolState.Function = &function;
+			s_PoolState.Count = count;
+			s_PoolState.ChunkCount = chunkCount;
+			s_PoolState.ChunkSize = (count + chunkCount - 1) / chunkCount;
+			s_PoolState.DoneChunks = 0;
+			s_PoolState.NextChunk = 0;
+			s_PoolState.Generation++;
+		}
+		s_PoolState.WorkAvailable.notify_all();
+
+		RunChunks();
+
+		std::unique_lock<std::mutex> lock(s_PoolState.Mutex);
+		s_PoolState.WorkDone.wait(lock, [&]() { return s_PoolState.DoneChunks == s_PoolState.ChunkCount; });
+	}
+}
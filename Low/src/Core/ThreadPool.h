@@ -0,0 +1,24 @@
+#pragma once
+
+namespace Low
+{
+	// [begin, end) range of a ParallelFor, together with the index of the chunk it belongs to
+	typedef std::function<void(uint32_t chunk, uint32_t begin, uint32_t end)> ParallelForFunction;
+
+	class ThreadPool
+	{
+	public:
+		// threadCount = 0 uses every hardware thread. The calling thread always takes part in the work, so one less
+		// worker is spawned
+		static void Init(uint32_t threadCount = 0);
+		static void Shutdown();
+
+		static uint32_t ThreadCount();
+		// Amount of chunks ParallelFor splits count elements into, so that callers can allocate per-chunk results
+		static uint32_t ChunkCount(uint32_t count, uint32_t minChunkSize);
+
+		// Splits [0, count) into ChunkCount(count, minChunkSize) chunks and runs them on the workers and the calling thread.
+		// Returns when all of them have been processed
+		static void ParallelFor(uint32_t count, uint32_t minChunkSize, const ParallelForFunction& function);
+	};
+}
@@ -1,19 +1,320 @@
 #include <Hardware/Memory.h>
 #include <stdexcept>
+#include <mutex>
 
 namespace Low
 {
-	uint32_t Memory::FindMemoryType(VkPhysicalDevice physDevice, uint32_t typeFilter, VkMemoryPropertyFlags props)
+	static const VkDeviceSize MinNodeSize = 256;
+	static const VkDeviceSize MaxBlockSize = 64 * 1024 * 1024;
+
+	// Buddy allocator over a single VkDeviceMemory. Nodes of order n are MinNodeSize << n bytes and aligned to their size,
+	// which covers any alignment up to the size of the node. Dedicated blocks hold a single resource and have no nodes
+	class MemoryBlock
 	{
-		VkPhysicalDeviceMemoryProperties memProperties;
-		vkGetPhysicalDeviceMemoryProperties(physDevice, &memProperties);
+	public:
+		MemoryBlock(VkDeviceMemory memory, VkDeviceSize size, void* mapped, uint32_t pool, bool dedicated) :
+			Memory(memory), Size(size), Mapped((uint8_t*)mapped), Pool(pool), Dedicated(dedicated)
+		{
+			if (dedicated)
+				return;
+
+			uint32_t maxOrder = 0;
+			while ((MinNodeSize << maxOrder) < size)
+				maxOrder++;
+			FreeNodes.resize(maxOrder + 1);
+			FreeNodes[maxOrder].insert(0);
+		}
+
+		std::optional<VkDeviceSize> Acquire(uint32_t order)
+		{
+			uint32_t level = order;
+			while (level < FreeNodes.size() && FreeNodes[level].empty())
+				level++;
+			if (level >= FreeNodes.size())
+				return {};
 
-		for (uint32_t i = 0; i < memProperties.memoryTypeCount; i++)
+			VkDeviceSize offset = *FreeNodes[level].begin();
+			FreeNodes[level].erase(FreeNodes[level].begin());
+			// Split down to the requested order, the upper halves stay free
+			while (level > order)
+			{
+				level--;
+				FreeNodes[level].insert(offset + (MinNodeSize << level));
+			}
+
+			Used += MinNodeSize << order;
+			return offset;
+		}
+
+		void Release(VkDeviceSize offset, uint32_t order)
 		{
-			if ((typeFilter & (1 << i)) && (memProperties.memoryTypes[i].propertyFlags & props) == props)
+			Used -= MinNodeSize << order;
+
+			// Merge with the buddy as long as it's free
+			while (order + 1 < FreeNodes.size())
+			{
+				VkDeviceSize buddy = offset ^ (MinNodeSize << order);
+				auto it = FreeNodes[order].find(buddy);
+				if (it == FreeNodes[order].end())
+					break;
+
+				FreeNodes[order].erase(it);
+				offset = std::min(offset, buddy);
+				order++;
+			}
+			FreeNodes[order].insert(offset);
+		}
+
+	public:
+		VkDeviceMemory Memory;
+		VkDeviceSize Size;
+		uint8_t* Mapped;
+		uint32_t Pool;
+		bool Dedicated;
+
+		VkDeviceSize Used = 0;
+		// Offsets of the free nodes of each order
+		std::vector<std::set<VkDeviceSize>> FreeNodes;
+	};
+
+	struct MemoryData
+	{
+		VkDevice Device = VK_NULL_HANDLE;
+		VkPhysicalDevice PhysicalDevice = VK_NULL_HANDLE;
+		VkPhysicalDeviceMemoryProperties Properties = {};
+
+		// Memory types that can back each usage, best first
+		std::array<std::vector<uint32_t>, (size_t)MemoryUsage::Count> Candidates;
+
+		// Per memory type
+		std::vector<VkDeviceSize> BlockSizes;
+		// Two pools per memory type: optimal images, then linear resources
+		std::vector<std::vector<MemoryBlock*>> Pools;
+		uint32_t BlockCount = 0;
+
+		// Resources can be created by the application and the render thread
+		std::mutex Mutex;
+	};
+
+	static MemoryData s_Data;
+
+	static MemoryBlock* CreateBlock(uint32_t type, VkDeviceSize size, uint32_t pool, bool dedicated)
+	{
+		VkMemoryAllocateInfo allocInfo = {};
+		allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+		allocInfo.allocationSize = size;
+		allocInfo.memoryTypeIndex = type;
+
+		// Running out of a heap isn't fatal, the next memory type is tried
+		VkDeviceMemory memory;
+		if (vkAllocateMemory(s_Data.Device, &allocInfo, nullptr, &memory) != VK_SUCCESS)
+			return nullptr;
+
+		void* mapped = nullptr;
+		if (s_Data.Properties.memoryTypes[type].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT)
+		{
+			if (vkMapMemory(s_Data.Device, memory, 0, VK_WHOLE_SIZE, 0, &mapped) != VK_SUCCESS)
+				throw std::runtime_error("Couldn't map device memory");
+		}
+
+		s_Data.BlockCount++;
+		return new MemoryBlock(memory, size, mapped, pool, dedicated);
+	}
+
+	static void DestroyBlock(MemoryBlock* block)
+	{
+		// Freeing the memory unmaps it
+		vkFreeMemory(s_Data.Device, block->Memory, nullptr);
+		s_Data.BlockCount--;
+		delete block;
+	}
+
+	void Memory::Init(VkDevice device, VkPhysicalDevice physDevice)
+	{
+		s_Data.Device = device;
+		s_Data.PhysicalDevice = physDevice;
+		vkGetPhysicalDeviceMemoryProperties(physDevice, &s_Data.Properties);
+
+		// Small heaps (e.g. host visible device memory) get smaller blocks, so that a few of them don't fill the heap
+		s_Data.BlockSizes.resize(s_Data.Properties.memoryTypeCount);
+		for (uint32_t i = 0; i < s_Data.Properties.memoryTypeCount; i++)
+		{
+			VkDeviceSize heapSize = s_Data.Properties.memoryHeaps[s_Data.Properties.memoryTypes[i].heapIndex].size;
+			VkDeviceSize blockSize = MaxBlockSize;
+			while (blockSize > MinNodeSize && blockSize * 8 > heapSize)
+				blockSize /= 2;
+			s_Data.BlockSizes[i] = blockSize;
+		}
+
+		s_Data.Pools.resize(s_Data.Properties.memoryTypeCount * 2);
+
+		// Required flags, then flags that make a type better, then flags that make it worse. Host visible memory is always
+		// coherent, so that nothing has to be flushed or invalidated
+		struct Preference { VkMemoryPropertyFlags Required, Preferred, Avoided; };
+		const VkMemoryPropertyFlags hostFlags = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+		std::array<Preference, (size_t)MemoryUsage::Count> preferences;
+		// Leave the device local memory visible to the host to the usages that benefit from it
+		preferences[(size_t)MemoryUsage::GpuOnly] = { VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, 0, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT };
+		preferences[(size_t)MemoryUsage::Upload] = { hostFlags, 0, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT };
+		preferences[(size_t)MemoryUsage::Readback] = { hostFlags, VK_MEMORY_PROPERTY_HOST_CACHED_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT };
+		preferences[(size_t)MemoryUsage::Dynamic] = { hostFlags, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, 0 };
+
+		for (uint32_t usage = 0; usage < (uint32_t)MemoryUsage::Count; usage++)
+		{
+			const Preference& pref = preferences[usage];
+			auto score = [&](uint32_t type)
+			{
+				VkMemoryPropertyFlags flags = s_Data.Properties.memoryTypes[type].propertyFlags;
+				return (flags & pref.Preferred ? 2 : 0) + (flags & pref.Avoided ? 0 : 1);
+			};
+
+			std::vector<uint32_t>& candidates = s_Data.Candidates[usage];
+			for (uint32_t i = 0; i < s_Data.Properties.memoryTypeCount; i++)
+			{
+				if ((s_Data.Properties.memoryTypes[i].propertyFlags & pref.Required) == pref.Required)
+					candidates.push_back(i);
+			}
+			std::stable_sort(candidates.begin(), candidates.end(), [&](uint32_t a, uint32_t b) { return score(a) > score(b); });
+		}
+	}
+
+	const VkPhysicalDeviceMemoryProperties& Memory::Properties()
+	{
+		return s_Data.Properties;
+	}
+
+	uint32_t Memory::FindMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags props)
+	{
+		for (uint32_t i = 0; i < s_Data.Properties.memoryTypeCount; i++)
+		{
+			if ((typeFilter & (1 << i)) && (s_Data.Properties.memoryTypes[i].propertyFlags & props) == props)
 				return i;
 		}
 
 		throw std::runtime_error("Couldn't find suitable memory type");
 	}
-}
\ No newline at end of file
+
+	// Returns an empty allocation if the memory type is out of memory
+	static MemoryAllocation AllocateFromType(uint32_t type, const VkMemoryRequirements& requirements, bool linear)
+	{
+		VkDeviceSize blockSize = s_Data.BlockSizes[type];
+
+		MemoryAllocation ret;
+		ret.Size = requirements.size;
+		ret.Coherent = (s_Data.Properties.memoryTypes[type].propertyFlags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT) != 0;
+
+		// Large resources would waste most of a block: they get their own memory
+		if (requirements.size > blockSize / 2)
+		{
+			ret.Block = CreateBlock(type, requirements.size, 0, true);
+			if (!ret.Block)
+				return {};
+			ret.Memory = ret.Block->Memory;
+			ret.Mapped = ret.Block->Mapped;
+			return ret;
+		}
+
+		VkDeviceSize nodeSize = std::max(requirements.size, requirements.alignment);
+		while ((MinNodeSize << ret.Order) < nodeSize)
+			ret.Order++;
+
+		uint32_t pool = type * 2 + (linear ? 1 : 0);
+		std::optional<VkDeviceSize> offset;
+		for (MemoryBlock* block : s_Data.Pools[pool])
+		{
+			offset = block->Acquire(ret.Order);
+			if (offset)
+			{
+				ret.Block = block;
+				break;
+			}
+		}
+
+		if (!offset)
+		{
+			ret.Block = CreateBlock(type, blockSize, pool, false);
+			if (!ret.Block)
+				return {};
+			s_Data.Pools[pool].push_back(ret.Block);
+			offset = ret.Block->Acquire(ret.Order);
+		}
+
+		ret.Memory = ret.Block->Memory;
+		ret.Offset = *offset;
+		if (ret.Block->Mapped)
+			ret.Mapped = ret.Block->Mapped + ret.Offset;
+
+		return ret;
+	}
+
+	MemoryAllocation Memory::Allocate(const VkMemoryRequirements& requirements, MemoryUsage usage, bool linear)
+	{
+		std::lock_guard<std::mutex> lock(s_Data.Mutex);
+
+		for (uint32_t type : s_Data.Candidates[(size_t)usage])
+		{
+			if (!(requirements.memoryTypeBits & (1 << type)))
+				continue;
+
+			MemoryAllocation ret = AllocateFromType(type, requirements, linear);
+			if (ret.Block)
+				return ret;
+		}
+
+		throw std::runtime_error("Couldn't allocate device memory");
+	}
+
+	MemoryAllocation Memory::AllocateBuffer(VkBuffer buffer, MemoryUsage usage)
+	{
+		VkMemoryRequirements requirements;
+		vkGetBufferMemoryRequirements(s_Data.Device, buffer, &requirements);
+
+		MemoryAllocation ret = Allocate(requirements, usage, true);
+		if (vkBindBufferMemory(s_Data.Device, buffer, ret.Memory, ret.Offset) != VK_SUCCESS)
+			throw std::runtime_error("Couldn't bind memory to buffer");
+		return ret;
+	}
+
+	MemoryAllocation Memory::AllocateImage(VkImage image, MemoryUsage usage, VkImageTiling tiling)
+	{
+		VkMemoryRequirements requirements;
+		vkGetImageMemoryRequirements(s_Data.Device, image, &requirements);
+
+		MemoryAllocation ret = Allocate(requirements, usage, tiling == VK_IMAGE_TILING_LINEAR);
+		if (vkBindImageMemory(s_Data.Device, image, ret.Memory, ret.Offset) != VK_SUCCESS)
+			throw std::runtime_error("Couldn't bind memory to image");
+		return ret;
+	}
+
+	void Memory::Free(MemoryAllocation& allocation)
+	{
+		MemoryBlock* block = allocation.Block;
+		if (!block)
+			return;
+
+		std::lock_guard<std::mutex> lock(s_Data.Mutex);
+
+		if (block->Dedicated)
+			DestroyBlock(block);
+		else
+		{
+			block->Release(allocation.Offset, allocation.Order);
+
+			// One empty block per pool is kept, resources are often recreated right after being destroyed (resizes)
+			std::vector<MemoryBlock*>& pool = s_Data.Pools[block->Pool];
+			if (block->Used == 0 && pool.size() > 1)
+			{
+				pool.erase(std::find(pool.begin(), pool.end(), block));
+				DestroyBlock(block);
+			}
+		}
+
+		allocation = {};
+	}
+
+	uint32_t Memory::BlockCount()
+	{
+		std::lock_guard<std::mutex> lock(s_Data.Mutex);
+		return s_Data.BlockCount;
+	}
+}
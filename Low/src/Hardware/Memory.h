@@ -2,9 +2,50 @@
 
 namespace Low
 {
+	class MemoryBlock;
+
+	// What the memory is used for, picks the memory type. GpuOnly: only accessed by the GPU. Upload: written once by the
+	// CPU and copied from (staging). Readback: written by the GPU and read by the CPU. Dynamic: written by the CPU and read
+	// by the GPU every frame, placed in device local memory the CPU can write to (resizable BAR, integrated GPUs) if there's any
+	enum class MemoryUsage { GpuOnly = 0, Upload, Readback, Dynamic, Count };
+
+	// Range of a block of device memory owned by a single resource. Empty (Memory is VK_NULL_HANDLE) until allocated
+	struct MemoryAllocation
+	{
+		VkDeviceMemory Memory = VK_NULL_HANDLE;
+		VkDeviceSize Offset = 0;
+		VkDeviceSize Size = 0;
+		// Start of the range in the persistently mapped block, nullptr if the memory isn't host visible
+		void* Mapped = nullptr;
+		// Host writes to the mapped range are visible to the device without flushing
+		bool Coherent = false;
+
+		MemoryBlock* Block = nullptr;
+		uint32_t Order = 0;
+	};
+
+	// Device memory is reserved in large blocks per memory type and handed out with a buddy allocator, instead of one
+	// vkAllocateMemory per resource. Buffers and linear images never share a block with optimal images, so that they can't
+	// end up on the same bufferImageGranularity page. Host visible blocks stay mapped for their whole life
 	class Memory
 	{
 	public:
-		static uint32_t FindMemoryType(VkPhysicalDevice physDevice, uint32_t typeFilter, VkMemoryPropertyFlags props);
+		// Queries the memory properties and ranks the memory types of every usage, once
+		static void Init(VkDevice device, VkPhysicalDevice physDevice);
+
+		static const VkPhysicalDeviceMemoryProperties& Properties();
+		// First memory type in typeFilter that has all of props
+		static uint32_t FindMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags props);
+
+		// Tries the memory types allowed by the requirements from best to worst for the usage, until one has room
+		static MemoryAllocation Allocate(const VkMemoryRequirements& requirements, MemoryUsage usage, bool linear);
+		// Allocate and bind
+		static MemoryAllocation AllocateBuffer(VkBuffer buffer, MemoryUsage usage);
+		static MemoryAllocation AllocateImage(VkImage image, MemoryUsage usage = MemoryUsage::GpuOnly, VkImageTiling tiling = VK_IMAGE_TILING_OPTIMAL);
+		// Resets the allocation, freeing an empty one does nothing
+		static void Free(MemoryAllocation& allocation);
+
+		// Number of VkDeviceMemory objects currently allocated
+		static uint32_t BlockCount();
 	};
-}
\ No newline at end of file
+}
@@ -53,21 +53,46 @@ namespace Low
 		std::vector<VkQueueFamilyProperties> queueProps(nQueues);
 		vkGetPhysicalDeviceQueueFamilyProperties(device, &nQueues, queueProps.data());
 
-		uint32_t i = 0;
+		// Headless: nothing is presented, the graphics queue stands in for the present one
+		auto supportsPresent = [&](uint32_t i)
+		{
+			if (surface == VK_NULL_HANDLE)
+				return (queueProps[i].queueFlags & VK_QUEUE_GRAPHICS_BIT) != 0;
+
+			VkBool32 present = VK_FALSE;
+			vkGetPhysicalDeviceSurfaceSupportKHR(device, i, surface, &present);
+			return present == VK_TRUE;
+		};
 
-		for (auto family : queueProps)
+		// Prefer a family that can both draw and present, the present queue is the graphics one
+		for (uint32_t i = 0; i < nQueues; i++)
 		{
-			if (family.queueFlags & VK_QUEUE_GRAPHICS_BIT)
+			if ((queueProps[i].queueFlags & VK_QUEUE_GRAPHICS_BIT) && supportsPresent(i))
+			{
 				ret.Graphics = i;
+				ret.Presentation = i;
+				break;
+			}
+		}
 
-			VkBool32 present;
-			vkGetPhysicalDeviceSurfaceSupportKHR(device, i, surface, &present);
-			if (present)
+		// Otherwise separate families
+		for (uint32_t i = 0; i < nQueues && !ret.Complete(); i++)
+		{
+			if ((queueProps[i].queueFlags & VK_QUEUE_GRAPHICS_BIT) && !ret.Graphics.has_value())
+				ret.Graphics = i;
+			if (!ret.Presentation.has_value() && supportsPresent(i))
 				ret.Presentation = i;
+		}
 
-			if (ret.Graphics.has_value() && ret.Presentation.has_value())
+		// Transfer only family, without graphics or compute
+		for (uint32_t i = 0; i < nQueues; i++)
+		{
+			VkQueueFlags flags = queueProps[i].queueFlags;
+			if ((flags & VK_QUEUE_TRANSFER_BIT) && !(flags & (VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT)))
+			{
+				ret.Transfer = i;
 				break;
-			i++;
+			}
 		}
 
 		return ret;
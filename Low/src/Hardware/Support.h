@@ -6,6 +6,8 @@ namespace Low
 	{
 		std::optional<uint32_t> Graphics;
 		std::optional<uint32_t> Presentation;
+		// Family that can only transfer (DMA engine), if the device has one
+		std::optional<uint32_t> Transfer;
 
 		bool Complete() { return Graphics.has_value() && Presentation.has_value(); }
 	};
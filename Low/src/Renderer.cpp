@@ -1,6 +1,8 @@
 #include <Renderer.h>
 
+#include <atomic>
 #include <chrono>
+#include <thread>
 
 #define GLM_FORCE_RADIANS
 #define GLM_FORCE_DEPTH_ZERO_TO_ONE
@@ -10,6 +12,9 @@
 
 #include <Core/Debug.h>
 #include <Core/State.h>
+#include <Core/ThreadPool.h>
+#include <Core/BoundedQueue.h>
+#include <Core/GpuProfiler.h>
 #include <Synchronization/Synchronization.h>
 
 #include <Vulkan/VulkanCore.h>
@@ -17,6 +22,7 @@
 #include <Vulkan/Swapchain.h>
 #include <Vulkan/RenderPass.h>
 #include <Vulkan/GraphicsPipeline.h>
+#include <Vulkan/ComputePipeline.h>
 
 #include <Vulkan/Descriptor/DescriptorSetLayout.h>
 #include <Vulkan/Descriptor/DescriptorPool.h>
@@ -25,6 +31,7 @@
 #include <Vulkan/Command/CommandPool.h>
 #include <Vulkan/Command/CommandBuffer.h>
 #include <Vulkan/Command/ImmediateCommands.h>
+#include <Vulkan/Command/TransferCommands.h>
 
 #include <Hardware/Support.h>
 #include <Hardware/Memory.h>
@@ -37,6 +44,13 @@
 #include <Resources/Shader.h>
 #include <Resources/Mesh.h>
 #include <Resources/MaterialInstance.h>
+#include <Resources/Camera.h>
+
+#include <Rendering/DrawSorter.h>
+#include <Rendering/FrustumCuller.h>
+#include <Rendering/FrameAllocator.h>
+#include <Rendering/DepthPyramid.h>
+#include <Rendering/StagingRing.h>
 
 #include <GLFW/glfw3.h>
 #include <stb_image.h>
@@ -44,14 +58,147 @@
 namespace Low
 {
 	std::vector<Ref<CommandBuffer>> Renderer::s_CommandBuffers;
-	std::unordered_map<UUID, std::vector<Renderable>> Renderer::s_Renderables;
+	RenderableRegistry Renderer::s_Registry;
+	RendererStats Renderer::s_Stats;
+	RenderableHandleAllocator Renderer::s_Handles;
+	FramePacket* Renderer::s_Packet = nullptr;
 	static RendererConfig s_Config;
 
-	struct RendererResources
+	// Below this amount of draws per thread, splitting the recording costs more than it saves
+	static const uint32_t s_MinDrawsPerThread = 256;
+	static const uint32_t s_CullGroupSize = 64;
+	static const uint32_t s_ClusterGroupSize = 64;
+	// Statistics collected around the geometry pass
+	static const VkQueryPipelineStatisticFlags s_StatisticsFlags = VK_QUERY_PIPELINE_STATISTIC_FRAGMENT_SHADER_INVOCATIONS_BIT;
+
+	// Layouts shared with cull.comp. Transforms are read from the object ring
+	struct GpuObjectData
+	{
+		glm::vec4 Sphere;
+		uint32_t Group;
+		// Handle index, indexes the level of detail history
+		uint32_t Slot;
+		uint32_t Padding[2];
+	};
+
+	struct GpuDrawGroup
+	{
+		uint32_t FirstCommand;
+		uint32_t LodCount;
+		uint32_t Padding[2];
+		// First index and index count of each level of detail
+		glm::uvec2 Lods[Mesh::MaxLods];
+	};
+
+	struct CullUniforms
+	{
+		glm::mat4 ViewProjection;
+		glm::vec4 Planes[6];
+		glm::vec2 PyramidSize;
+		uint32_t ObjectCount;
+		// 0 when the pyramid doesn't hold any depth yet: the early phase only frustum culls
+		uint32_t Occlusion;
+		// Level of detail selection, see SelectLod
+		glm::vec4 CameraPosition;
+		float ProjectionScale;
+		float LodThreshold;
+		float LodHysteresis;
+	};
+
+	struct CullPushConstants
+	{
+		// 0 for the early phase, 1 for the late one
+		uint32_t Late;
+	};
+
+	// Consecutive draws of the sorted list sharing mesh, level of detail and material
+	struct InstancedDraw
+	{
+		Low::Mesh* Mesh;
+		uint32_t Lod;
+		uint32_t Batch;
+		uint32_t FirstInstance;
+		uint32_t InstanceCount;
+	};
+
+	// Transforms of every renderable, indexed by handle index, with a region per frame in flight selected with a dynamic
+	// offset. Renderables keep their place while others are added and removed, so only the transforms that changed since
+	// a region was last written are copied to it
+	struct ObjectRing
+	{
+		Ref<Buffer> Transforms;
+		glm::mat4* Mapped = nullptr;
+
+		// Size of a region in matrices, then in bytes once aligned to minStorageBufferOffsetAlignment
+		uint32_t Capacity = 0;
+		VkDeviceSize RegionSize = 0;
+
+		// Per region: slots changed since it was last written, and whether everything has to be copied (new buffer)
+		std::vector<std::vector<uint32_t>> Pending;
+		std::vector<bool> Stale;
+	};
+
+	// Buffers used by a single frame in flight in the GPU driven path
+	struct GpuFrameData
+	{
+		Ref<Buffer> Objects;
+		Ref<Buffer> Groups;
+		Ref<Buffer> Commands;
+		Ref<Buffer> Counts;
+		// Objects the early phase rejected with the previous frame's depth, tested again by the late phase
+		Ref<Buffer> Occluded;
+		Ref<Buffer> Uniforms;
+
+		GpuObjectData* ObjectsMapped = nullptr;
+		GpuDrawGroup* GroupsMapped = nullptr;
+		CullUniforms* UniformsMapped = nullptr;
+
+		uint32_t ObjectCapacity = 0;
+		uint32_t GroupCapacity = 0;
+	};
+
+	// Layouts shared with cluster.comp and lighting.frag
+	struct GpuLight
+	{
+		glm::vec4 PositionRadius;
+		glm::vec4 Color;
+	};
+
+	struct ClusterUniforms
+	{
+		glm::mat4 InverseProjection;
+		glm::mat4 View;
+		glm::vec2 ScreenSize;
+		float Near;
+		float Far;
+		// xyz: size of the grid, w: amount of lights
+		glm::uvec4 GridSize;
+	};
+
+	// Buffers used by a single frame in flight to bin and shade the lights
+	struct LightFrameData
+	{
+		Ref<Buffer> Uniforms;
+		Ref<Buffer> Lights;
+		// Written by cluster.comp, read by lighting.frag
+		Ref<Buffer> Counts;
+		Ref<Buffer> Indices;
+
+		ClusterUniforms* UniformsMapped = nullptr;
+		GpuLight* LightsMapped = nullptr;
+		uint32_t LightCapacity = 0;
+	};
+
+	// A (material, mesh) pair: drawn with a single vkCmdDrawIndexedIndirectCount
+	struct GpuGroup
 	{
-		// Buffers
-		std::vector<Ref<Buffer>> UniformBuffers;
+		Low::Mesh* Mesh;
+		uint32_t FirstCommand;
+		uint32_t Capacity;
+	};
 
+	struct RendererResources
+	{
 		// Resources
 		Ref<Shader> Shader;
 		Ref<Low::Texture> Texture;
@@ -68,54 +215,269 @@ namespace Low
 		// Resources
 		RendererResources* Resources;
 
-		// Pipeline
-		Ref<RenderPass> RenderPass;
-		Ref<GraphicsPipeline> GraphicsPipeline;
+		// Deferred shading: the geometry pass fills the G-buffer, the lighting pass shades every pixel of it once
+		Ref<RenderPass> GeometryPass;
+		Ref<GraphicsPipeline> GeometryPipeline;
+		// Same attachments, loaded instead of cleared: draws the objects found visible by the late culling phase
+		Ref<RenderPass> GeometryLatePass;
+		// Depth prepass: a depth only pipeline, then a geometry pipeline that only shades the fragments matching its depth
+		Ref<GraphicsPipeline> DepthPrepassPipeline;
+		Ref<GraphicsPipeline> GeometryEqualPipeline;
+		bool DepthPrepass = false;
+		Ref<RenderPass> LightingPass;
+		Ref<GraphicsPipeline> LightingPipeline;
+		// One G-buffer per frame in flight, read by the lighting pass through a set per frame in flight
+		std::vector<Ref<Framebuffer>> GBuffers;
+		VkSampler GBufferSampler;
+		VkDescriptorSetLayout LightingDescriptorSetLayout;
+		std::vector<VkDescriptorSet> LightingDescriptorSets;
+
+		// Clustered lighting: lights are binned by a compute pass before the geometry pass
+		Ref<ComputePipeline> ClusterPipeline;
+		VkDescriptorSetLayout ClusterDescriptorSetLayout;
+		std::vector<VkDescriptorSet> ClusterDescriptorSets;
+		std::vector<LightFrameData> LightFrames;
+		std::vector<PointLight> Lights;
+		// Targets of the lighting pass: one per swapchain image, or one per frame in flight when headless
 		std::vector<Ref<Framebuffer>> Framebuffers;
+		glm::vec2 Extent;
+
+		// Headless readback: host visible copies of the color target of each frame in flight
+		std::vector<Ref<Buffer>> Readbacks;
+		int32_t LastReadback = -1;
+		uint64_t LastReadbackValue = 0;
+
+		// Frame timeline value signaled by the last submission of each frame in flight
+		std::vector<uint64_t> FrameValues;
 
 		// Commands
 		Ref<CommandPool> CommandPool;
 		std::vector<Ref<CommandBuffer>> CommandBuffers;
+		// Draws are recorded in parallel: every thread has its own pool and secondary buffer for each frame in flight
+		std::vector<std::vector<Ref<CommandPool>>> RecordingPools;
+		std::vector<std::vector<Ref<CommandBuffer>>> SecondaryBuffers;
+		// Allocated from the same pools, executed before the secondary buffers when the depth prepass is enabled
+		std::vector<std::vector<Ref<CommandBuffer>>> PrepassBuffers;
+
+		// One pipeline statistics query per frame in flight, read the next time the frame is started
+		VkQueryPool StatisticsPool = VK_NULL_HANDLE;
+		std::vector<bool> StatisticsWritten;
+
+		// GPU driven path
+		Ref<ComputePipeline> CullPipeline;
+		VkDescriptorSetLayout CullDescriptorSetLayout;
+		std::vector<VkDescriptorSet> CullDescriptorSets;
+		std::vector<GpuFrameData> GpuFrames;
+		std::vector<GpuGroup> GpuGroups;
+		std::unordered_map<uint64_t, uint32_t> GpuGroupIndices;
+		std::vector<uint32_t> GpuObjectGroups;
+		uint32_t GpuObjectCount = 0;
+		// Level of detail each renderable was drawn with, for the hysteresis. Indexed by handle index and shared by all the
+		// frames, so that the selection is compared with the previous frame's one
+		Ref<Buffer> GpuLods;
+		uint32_t GpuLodCapacity = 0;
+		// Built from the G-buffer depth after the early draws, read by the late phase and the early phase of the next frame
+		Ref<DepthPyramid> Pyramid;
 
 		// Uniforms
 		VkDescriptorSetLayout DescriptorSetLayout;
 		VkDescriptorPool DescriptorPool;
 		std::vector<VkDescriptorSet> DescriptorSets;
-		
-		std::vector<VkDeviceMemory> UniformBuffersMemory;
-		std::vector<void*> UniformBuffersMapped;
 
 		std::unordered_map<std::string, void*> GlobalUniformsMapped;
 
+		// Frame
+		Low::Camera Camera;
+		std::vector<DrawItem> DrawList;
+		DrawSorter Sorter;
+		FrustumCuller Culler;
+		std::vector<uint32_t> Visible;
+		std::vector<InstancedDraw> InstancedDraws;
+		// Transient data: camera and instances are allocated every frame from the allocator of the frame
+		std::vector<Ref<FrameAllocator>> FrameAllocators;
+		// Buffer the camera descriptor of each frame points to, rewritten only if the allocator grows
+		std::vector<VkBuffer> CameraDescriptorBuffers;
+		uint32_t CameraOffset = 0;
+		FrameAllocation Instances;
+		ObjectRing Objects;
+
 		GLFWwindow* WindowHandle;
+		// Written by the window callback, read by the thread drawing the frames
+		std::atomic<int> FramebufferWidth = 0;
+		std::atomic<int> FramebufferHeight = 0;
+		std::atomic<bool> FramebufferResized = false;
 
 	} s_Data;
 
+	// Packets go to the render thread through Submitted and come back through Free once drawn. There are only two of them, so
+	// the application is never more than a frame ahead of the renderer
+	struct RenderThreadData
+	{
+		std::thread Thread;
+		FramePacket Packets[2];
+		BoundedQueue<FramePacket*> Submitted{ 1 };
+		BoundedQueue<FramePacket*> Free{ 2 };
+
+		std::mutex StatsMutex;
+		RendererStats PublishedStats;
+	} s_RenderThread;
+
 	struct UniformBufferObject
 	{
-		glm::mat4 Model;
 		glm::mat4 View;
 		glm::mat4 Projection;
 	};
 
+	// Layout shared with lighting.frag
+	struct LightingPushConstants
+	{
+		glm::mat4 InverseViewProjection;
+		glm::vec4 CameraPosition;
+	};
+
+	static std::vector<FramebufferAttachmentSpecs> GBufferSpecs()
+	{
+		// Albedo, normal, then metallic / roughness / AO
+		return {
+			{AttachmentType::Color, VK_FORMAT_R8G8B8A8_SRGB, 1, false},
+			{AttachmentType::Color, VK_FORMAT_A2B10G10R10_UNORM_PACK32, 1, false},
+			{AttachmentType::Color, VK_FORMAT_R8G8B8A8_UNORM, 1, false},
+			{AttachmentType::Depth, VK_FORMAT_D32_SFLOAT, 1, false}
+		};
+	}
+
+	static std::vector<FramebufferAttachmentSpecs> GBufferLateSpecs()
+	{
+		// Draws on top of what the early geometry pass left
+		std::vector<FramebufferAttachmentSpecs> specs = GBufferSpecs();
+		for (auto& spec : specs)
+		{
+			spec.Description.loadOp = VK_ATTACHMENT_LOAD_OP_LOAD;
+			spec.Description.initialLayout = spec.Reference.layout;
+		}
+		return specs;
+	}
+
+	static std::vector<FramebufferAttachmentSpecs> OutputSpecs()
+	{
+		// Headless frames render into color targets owned by the framebuffers
+		return { {AttachmentType::Color, VK_FORMAT_B8G8R8A8_SRGB, 1, !s_Config.Headless} };
+	}
+
+	static void WriteLightingDescriptors(uint32_t frame)
+	{
+		Ref<Framebuffer> gBuffer = s_Data.GBuffers[frame];
+
+		std::array<VkDescriptorImageInfo, 4> imageInfos = {};
+		for (uint32_t i = 0; i < 3; i++)
+		{
+			imageInfos[i].sampler = s_Data.GBufferSampler;
+			imageInfos[i].imageView = gBuffer->GetAttachment(AttachmentType::Color, i).ImageView;
+			imageInfos[i].imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+		}
+		imageInfos[3].sampler = s_Data.GBufferSampler;
+		imageInfos[3].imageView = gBuffer->GetAttachment(AttachmentType::Depth, 0).ImageView;
+		imageInfos[3].imageLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
+
+		std::array<VkWriteDescriptorSet, 4> descriptorWrites({});
+		for (uint32_t i = 0; i < imageInfos.size(); i++)
+		{
+			descriptorWrites[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+			descriptorWrites[i].dstSet = s_Data.LightingDescriptorSets[frame];
+			descriptorWrites[i].dstBinding = i;
+			descriptorWrites[i].dstArrayElement = 0;
+			descriptorWrites[i].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+			descriptorWrites[i].descriptorCount = 1;
+			descriptorWrites[i].pImageInfo = &imageInfos[i];
+		}
+
+		vkUpdateDescriptorSets(VulkanCore::Device(), descriptorWrites.size(), descriptorWrites.data(), 0, nullptr);
+	}
+
+	static void WriteLightBufferDescriptors(uint32_t frame)
+	{
+		LightFrameData& data = s_Data.LightFrames[frame];
+
+		std::array<VkDescriptorBufferInfo, 4> bufferInfos = {};
+		Ref<Buffer> buffers[] = { data.Uniforms, data.Lights, data.Counts, data.Indices };
+		for (uint32_t i = 0; i < bufferInfos.size(); i++)
+		{
+			bufferInfos[i].buffer = *buffers[i];
+			bufferInfos[i].offset = 0;
+			bufferInfos[i].range = VK_WHOLE_SIZE;
+		}
+
+		// Same buffers in both sets: bindings 0 to 3 of the binning pass, 4 to 7 of the lighting pass
+		std::array<VkWriteDescriptorSet, 8> descriptorWrites({});
+		for (uint32_t i = 0; i < descriptorWrites.size(); i++)
+		{
+			uint32_t buffer = i % 4;
+
+			descriptorWrites[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+			descriptorWrites[i].dstSet = i < 4 ? s_Data.ClusterDescriptorSets[frame] : s_Data.LightingDescriptorSets[frame];
+			descriptorWrites[i].dstBinding = i;
+			descriptorWrites[i].dstArrayElement = 0;
+			descriptorWrites[i].descriptorType = buffer == 0 ? VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER : VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+			descriptorWrites[i].descriptorCount = 1;
+			descriptorWrites[i].pBufferInfo = &bufferInfos[buffer];
+		}
+
+		vkUpdateDescriptorSets(VulkanCore::Device(), descriptorWrites.size(), descriptorWrites.data(), 0, nullptr);
+	}
+
+	static void ReserveLightBuffers(uint32_t frame, uint32_t lightCount)
+	{
+		LightFrameData& data = s_Data.LightFrames[frame];
+		if (lightCount <= data.LightCapacity && data.Lights)
+			return;
+
+		// Only called after the frame's timeline value has been waited, so the old buffer isn't in use anymore
+		data.LightCapacity = std::max(std::max(lightCount, data.LightCapacity * 2), 64u);
+		data.Lights = CreateRef<Buffer>(data.LightCapacity * sizeof(GpuLight), BufferUsage::Storage);
+		data.LightsMapped = (GpuLight*)data.Lights->Mapped();
+
+		// The grid doesn't depend on the amount of lights
+		if (!data.Uniforms)
+		{
+			data.Uniforms = CreateRef<Buffer>(sizeof(ClusterUniforms), BufferUsage::Uniform);
+			data.Counts = CreateRef<Buffer>(ClusterGrid::Count * sizeof(uint32_t), BufferUsage::DeviceStorage);
+			data.Indices = CreateRef<Buffer>(ClusterGrid::Count * ClusterGrid::MaxLightsPerCluster * sizeof(uint32_t), BufferUsage::DeviceStorage);
+			data.UniformsMapped = (ClusterUniforms*)data.Uniforms->Mapped();
+		}
+
+		WriteLightBufferDescriptors(frame);
+	}
+
 	static void ResizeScreen()
 	{
-		int width = 0, height = 0;
-		glfwGetFramebufferSize(s_Data.WindowHandle, &width, &height);
-		while (width == 0 || height == 0)
+		// Only the thread polling the window can wait for it to be restored, the render thread skips frames until then
+		if (!s_Config.RenderThread)
 		{
+			int width = 0, height = 0;
 			glfwGetFramebufferSize(s_Data.WindowHandle, &width, &height);
-			glfwWaitEvents();
+			while (width == 0 || height == 0)
+			{
+				glfwGetFramebufferSize(s_Data.WindowHandle, &width, &height);
+				glfwWaitEvents();
+			}
+
+			s_Data.FramebufferWidth = width;
+			s_Data.FramebufferHeight = height;
+			s_Data.FramebufferResized = false;
 		}
 
+		int width = s_Data.FramebufferWidth, height = s_Data.FramebufferHeight;
+		if (width == 0 || height == 0)
+			return;
+
 		vkDeviceWaitIdle(VulkanCore::Device());
 
-		std::vector<FramebufferAttachmentSpecs> attachmentSpecs = {
-			{AttachmentType::Color, VK_FORMAT_B8G8R8A8_SRGB, 1, true},
-			{AttachmentType::Depth, VK_FORMAT_D32_SFLOAT, 1, false}
-		};
+		std::vector<FramebufferAttachmentSpecs> attachmentSpecs = OutputSpecs();
 
 		s_Data.Swapchain->Invalidate(width, height);
+		s_Data.Extent = s_Data.Swapchain->Extent();
+		// Only the images and their views are recreated with dynamic rendering. Pipelines never are: viewport and scissor
+		// are dynamic states
 		for (uint32_t i = 0; i < s_Data.Framebuffers.size(); i++)
 		{
 			std::vector<VkImage> images;
@@ -125,28 +487,62 @@ namespace Low
 				else
 					images.push_back(VK_NULL_HANDLE);
 
-			s_Data.Framebuffers[i]->Invalidate(*s_Data.RenderPass, width, height, attachmentSpecs, images);
+			s_Data.Framebuffers[i]->Invalidate(*s_Data.LightingPass, width, height, attachmentSpecs, images);
+		}
+
+		// The G-buffers follow the size of the screen, the lighting sets have to point to their new images
+		std::vector<FramebufferAttachmentSpecs> gBufferSpecs = GBufferSpecs();
+		for (uint32_t i = 0; i < s_Data.GBuffers.size(); i++)
+		{
+			s_Data.GBuffers[i]->Invalidate(*s_Data.GeometryPass, width, height, gBufferSpecs, std::vector<VkImage>(gBufferSpecs.size(), VK_NULL_HANDLE));
+			WriteLightingDescriptors(i);
+		}
+
+		// So does the pyramid, which starts over empty
+		if (s_Data.Pyramid)
+		{
+			s_Data.Pyramid->Resize(width, height);
+			for (uint32_t i = 0; i < s_Data.GBuffers.size(); i++)
+			{
+				s_Data.Pyramid->SetSource(i, s_Data.GBuffers[i]->GetAttachment(AttachmentType::Depth, 0).ImageView);
+				WriteGpuDescriptors(i);
+			}
 		}
 	}
 
 	static void OnFramebufferResize(GLFWwindow* window, int width, int height)
 	{
-		ResizeScreen();
+		// Called while polling events, possibly while another thread is drawing: the swapchain is recreated before the next frame
+		s_Data.FramebufferWidth = width;
+		s_Data.FramebufferHeight = height;
+		s_Data.FramebufferResized = true;
 	}
 
-	static void CreateUniformBuffers()
+	static void CreateFrameAllocators()
 	{
-		VkDeviceSize bufferSize = sizeof(UniformBufferObject);
-
-		s_Data.Resources->UniformBuffers.resize(s_Config.MaxFramesInFlight);
-		s_Data.UniformBuffersMemory.resize(s_Config.MaxFramesInFlight);
-		s_Data.UniformBuffersMapped.resize(s_Config.MaxFramesInFlight);
-
 		for (uint32_t i = 0; i < s_Config.MaxFramesInFlight; i++)
-		{
-			s_Data.Resources->UniformBuffers[i] = CreateRef<Buffer>(bufferSize, BufferUsage::Uniform);
-			vkMapMemory(VulkanCore::Device(), s_Data.Resources->UniformBuffers[i]->Memory(), 0, bufferSize, 0, &s_Data.UniformBuffersMapped[i]);
-		}
+			s_Data.FrameAllocators.push_back(CreateRef<FrameAllocator>(s_Config.FrameArenaSize));
+	}
+
+	static void WriteCameraDescriptor(uint32_t frame, VkBuffer buffer)
+	{
+		// Dynamic uniform: the offset of the camera in the allocator is given when binding the set
+		VkDescriptorBufferInfo bufferInfo = {};
+		bufferInfo.buffer = buffer;
+		bufferInfo.offset = 0;
+		bufferInfo.range = sizeof(UniformBufferObject);
+
+		VkWriteDescriptorSet descriptorWrite = {};
+		descriptorWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		descriptorWrite.dstSet = s_Data.DescriptorSets[frame];
+		descriptorWrite.dstBinding = 0;
+		descriptorWrite.dstArrayElement = 0;
+		descriptorWrite.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+		descriptorWrite.descriptorCount = 1;
+		descriptorWrite.pBufferInfo = &bufferInfo;
+
+		vkUpdateDescriptorSets(VulkanCore::Device(), 1, &descriptorWrite, 0, nullptr);
+		s_Data.CameraDescriptorBuffers[frame] = buffer;
 	}
 
 	static void CreateDescriptorSets()
@@ -168,11 +564,6 @@ namespace Low
 		for (uint32_t i = 0; i < s_Config.MaxFramesInFlight; i++)
 		{
 			// Use descriptor writes to set the values (MaterialInstance)
-			VkDescriptorBufferInfo bufferInfo = {};
-			bufferInfo.buffer = *s_Data.Resources->UniformBuffers[i];
-			bufferInfo.offset = 0;
-			bufferInfo.range = sizeof(UniformBufferObject);
-
 			VkDescriptorImageInfo roughness = {};
 			roughness.sampler = *s_Data.Resources->Roughness->Sampler();
 			roughness.imageView = s_Data.Resources->Roughness->ImageView();
@@ -183,288 +574,1480 @@ namespace Low
 			samplerInfo.imageView = s_Data.Resources->Texture->ImageView();
 			samplerInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
 
-			std::array<VkWriteDescriptorSet, 3> descriptorWrites({});
+			std::array<VkWriteDescriptorSet, 2> descriptorWrites({});
 			descriptorWrites[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
 			descriptorWrites[0].dstSet = s_Data.DescriptorSets[i];
-			descriptorWrites[0].dstBinding = 0;
+			descriptorWrites[0].dstBinding = 1;
 			descriptorWrites[0].dstArrayElement = 0;
-			descriptorWrites[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+			descriptorWrites[0].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
 			descriptorWrites[0].descriptorCount = 1;
-			descriptorWrites[0].pBufferInfo = &bufferInfo;
-			descriptorWrites[0].pNext = VK_NULL_HANDLE;
+			descriptorWrites[0].pImageInfo = &samplerInfo;
 
 			descriptorWrites[1].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
 			descriptorWrites[1].dstSet = s_Data.DescriptorSets[i];
-			descriptorWrites[1].dstBinding = 1;
+			descriptorWrites[1].dstBinding = 2;
 			descriptorWrites[1].dstArrayElement = 0;
 			descriptorWrites[1].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
 			descriptorWrites[1].descriptorCount = 1;
-			descriptorWrites[1].pImageInfo = &samplerInfo;
-
-			descriptorWrites[2].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-			descriptorWrites[2].dstSet = s_Data.DescriptorSets[i];
-			descriptorWrites[2].dstBinding = 2;
-			descriptorWrites[2].dstArrayElement = 0;
-			descriptorWrites[2].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-			descriptorWrites[2].descriptorCount = 1;
-			descriptorWrites[2].pImageInfo = &roughness;
+			descriptorWrites[1].pImageInfo = &roughness;
 
 			vkUpdateDescriptorSets(VulkanCore::Device(), descriptorWrites.size(), descriptorWrites.data(), 0, nullptr);
 		}
+
+		s_Data.CameraDescriptorBuffers.resize(s_Config.MaxFramesInFlight);
+		for (uint32_t i = 0; i < s_Config.MaxFramesInFlight; i++)
+			WriteCameraDescriptor(i, s_Data.FrameAllocators[i]->CurrentBuffer());
 	}
 
-	static void UpdateUniformBuffer(uint32_t currentImage)
+	static void ReserveObjectRing(uint32_t count)
 	{
-		static auto startTime = std::chrono::high_resolution_clock::now();
+		ObjectRing& ring = s_Data.Objects;
+		if (count <= ring.Capacity && ring.Transforms)
+			return;
 
-		auto currentTime = std::chrono::high_resolution_clock::now();
-		float time = std::chrono::duration<float, std::chrono::seconds::period>(currentTime - startTime).count();
+		// The regions of all the frames live in the same buffer: none of them can be in use while it's replaced
+		Ref<Timeline> timeline = Synchronization::FrameTimeline();
+		timeline->Wait(timeline->Submitted());
 
-		uint32_t w = s_Data.Swapchain->Extent().x;
-		uint32_t h = s_Data.Swapchain->Extent().y;
-		float ratio = (float)w / h;
+		VkPhysicalDeviceProperties properties;
+		vkGetPhysicalDeviceProperties(VulkanCore::PhysicalDevice(), &properties);
+		VkDeviceSize alignment = properties.limits.minStorageBufferOffsetAlignment;
 
-		UniformBufferObject ubo = {};
-		ubo.Model = glm::rotate(glm::mat4(1.0f), time * 0.75f * glm::radians(90.0f), glm::vec3(0.0f, 1.0f, 0.0f));
-		ubo.View = glm::lookAt(glm::vec3(0.0f, 0.0f, 4), glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
-		ubo.Projection = glm::perspective(glm::radians(45.0f), (float)w / h, 0.1f, 10.0f);
-		ubo.Projection[1][1] *= -1;
+		ring.Capacity = std::max(std::max(count, ring.Capacity * 2), 1024u);
+		ring.RegionSize = (ring.Capacity * sizeof(glm::mat4) + alignment - 1) / alignment * alignment;
+		ring.Transforms = CreateRef<Buffer>(ring.RegionSize * s_Config.MaxFramesInFlight, BufferUsage::Storage);
+		ring.Mapped = (glm::mat4*)ring.Transforms->Mapped();
+
+		// Everything has to be copied again in the new buffer
+		ring.Pending.assign(s_Config.MaxFramesInFlight, {});
+		ring.Stale.assign(s_Config.MaxFramesInFlight, true);
 
-		memcpy(s_Data.UniformBuffersMapped[currentImage], &ubo, sizeof(UniformBufferObject));
+		for (uint32_t i = 0; i < s_Config.MaxFramesInFlight; i++)
+		{
+			VkDescriptorBufferInfo bufferInfo = {};
+			bufferInfo.buffer = *ring.Transforms;
+			bufferInfo.offset = 0;
+			bufferInfo.range = ring.RegionSize;
+
+			VkWriteDescriptorSet descriptorWrite = {};
+			descriptorWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+			descriptorWrite.dstSet = s_Data.DescriptorSets[i];
+			descriptorWrite.dstBinding = 3;
+			descriptorWrite.dstArrayElement = 0;
+			descriptorWrite.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC;
+			descriptorWrite.descriptorCount = 1;
+			descriptorWrite.pBufferInfo = &bufferInfo;
+
+			vkUpdateDescriptorSets(VulkanCore::Device(), 1, &descriptorWrite, 0, nullptr);
+		}
 	}
-	
-	static void CreateTextures()
+
+	static void UploadObjects(RenderableRegistry& registry)
 	{
-		s_Data.Resources->Texture = CreateRef<Texture>("../../Assets/Models/Sphere/Rusty/rustediron2_basecolor.png", VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_TILING_OPTIMAL);
-		s_Data.Resources->Roughness = CreateRef<Texture>("../../Assets/Models/Sphere/Rusty/rustediron2_metallic.png", VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_TILING_OPTIMAL);
+		uint32_t frame = State::CurrentFramebufferIndex();
+		ReserveObjectRing(registry.SlotCount());
+
+		// Changes are queued for every region, each one catches up the next time it's written
+		ObjectRing& ring = s_Data.Objects;
+		const std::vector<uint32_t>& dirty = registry.DirtySlots();
+		for (auto& pending : ring.Pending)
+			pending.insert(pending.end(), dirty.begin(), dirty.end());
+		registry.ClearDirty();
+
+		glm::mat4* region = (glm::mat4*)((uint8_t*)ring.Mapped + frame * ring.RegionSize);
+		if (ring.Stale[frame])
+		{
+			for (auto& batch : registry.Batches())
+			{
+				for (uint32_t i = 0; i < batch.Size(); i++)
+					region[batch.Owners[i]] = batch.Transforms[i];
+			}
+			ring.Stale[frame] = false;
+		}
+		else
+		{
+			// Removed renderables don't need anything: nothing reads their slot until it's reused, which marks it again
+			for (uint32_t slot : ring.Pending[frame])
+			{
+				if (const glm::mat4* transform = registry.Transform(slot))
+					region[slot] = *transform;
+			}
+		}
+		ring.Pending[frame].clear();
 	}
 
-	void Renderer::Init(RendererConfig config, GLFWwindow* windowHandle)
+	static uint32_t ObjectsOffset()
 	{
-		int width, height;
-		glfwGetWindowSize(windowHandle, &width, &height);
-
-		VulkanCoreConfig coreConfig;
-		for (uint32_t i = 0; i < config.ExtensionCount; i++)
-			coreConfig.UserExtensions.push_back(config.Extensions[i]);
-		coreConfig.WindowHandle = windowHandle;
-		coreConfig.MaxFramesInFlight = config.MaxFramesInFlight;
-
-		s_Config = config;
-		s_Data.WindowHandle = windowHandle;
-		s_Data.Resources = new RendererResources();
-
-		VulkanCore::Init(coreConfig);
-		
-		s_Data.GraphicsQueue = VulkanCore::GraphicsQueue();
-		s_Data.PresentationQueue = VulkanCore::PresentQueue();
-
-		s_Data.Swapchain = CreateRef<Swapchain>(width, height);
-
-		glfwSetFramebufferSizeCallback(windowHandle, OnFramebufferResize);
-
-		// DescriptorSetType type, DescriptorStageFlags stage, uint32_t binding, uint32_t amount
-		DescriptorSetLayout descriptorSetLayout({
-			DescriptorSetBinding(DescriptorSetType::Buffer, ShaderStage::Vertex, 0, 1),
-			DescriptorSetBinding(DescriptorSetType::Sampler, ShaderStage::Fragment, 1, 1),
-			DescriptorSetBinding(DescriptorSetType::Sampler, ShaderStage::Fragment, 2, 1)
-		});
-		s_Data.DescriptorSetLayout = descriptorSetLayout;
-		s_Data.DescriptorPool = *VulkanCore::DescriptorPool();
-
-		CreateUniformBuffers();
+		return State::CurrentFramebufferIndex() * s_Data.Objects.RegionSize;
+	}
 
-		s_Data.CommandPool = CreateRef<CommandPool>(Support::GetQueueFamilyIndices(VulkanCore::PhysicalDevice(), VulkanCore::Surface()));
-		ImmediateCommands::Init(*s_Data.CommandPool);
+	static void BindGlobalDescriptors(VkCommandBuffer commandBuffer)
+	{
+		// Dynamic offsets follow the binding order: camera, then objects
+		uint32_t offsets[] = { s_Data.CameraOffset, ObjectsOffset() };
+		vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, s_Data.GeometryPipeline->Layout(), 0, 1,
+			&s_Data.DescriptorSets[State::CurrentFramebufferIndex()], 2, offsets);
+	}
 
-		std::vector<Ref<CommandBuffer>> commandBuffers = s_Data.CommandPool->AllocateCommandBuffers(s_Config.MaxFramesInFlight);
-		for (auto& buf : commandBuffers)
-			s_Data.CommandBuffers.push_back(buf);
+	static void WriteGpuDescriptors(uint32_t frame)
+	{
+		GpuFrameData& data = s_Data.GpuFrames[frame];
 
-		std::vector<FramebufferAttachmentSpecs> attachmentSpecs = {
-			{AttachmentType::Color, VK_FORMAT_B8G8R8A8_SRGB, 1, true},
-			{AttachmentType::Depth, VK_FORMAT_D32_SFLOAT, 1, false}
-		};
+		// Storage buffers, except the uniforms in binding 4
+		std::array<VkDescriptorBufferInfo, 7> bufferInfos = {};
+		Ref<Buffer> buffers[] = { data.Objects, data.Groups, data.Commands, data.Counts, data.Uniforms, data.Occluded, s_Data.GpuLods };
+		uint32_t bindings[] = { 0, 1, 2, 3, 4, 6, 7 };
+		for (uint32_t i = 0; i < bufferInfos.size(); i++)
+		{
+			bufferInfos[i].buffer = *buffers[i];
+			bufferInfos[i].offset = 0;
+			bufferInfos[i].range = VK_WHOLE_SIZE;
+		}
 
-		s_Data.RenderPass = CreateRef<RenderPass>(attachmentSpecs);
+		VkDescriptorImageInfo pyramidInfo = {};
+		pyramidInfo.sampler = s_Data.Pyramid->Sampler();
+		pyramidInfo.imageView = s_Data.Pyramid->View();
+		pyramidInfo.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
 
-		for (uint32_t i = 0; i < s_Data.Swapchain->Images().size(); i++)
+		std::array<VkWriteDescriptorSet, 8> descriptorWrites({});
+		for (uint32_t i = 0; i < descriptorWrites.size(); i++)
 		{
-			std::vector<VkImage> images;
-			for (auto spec : attachmentSpecs)
-				if (spec.IsSwapchain)
-					images.push_back(s_Data.Swapchain->Images()[i]);
-				else
-					images.push_back(VK_NULL_HANDLE);
+			descriptorWrites[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+			descriptorWrites[i].dstSet = s_Data.CullDescriptorSets[frame];
+			descriptorWrites[i].dstArrayElement = 0;
+			descriptorWrites[i].descriptorCount = 1;
 
-			Ref<Framebuffer> framebuffer = CreateRef<Framebuffer>(*s_Data.RenderPass, width, height, attachmentSpecs, images);
-			s_Data.Framebuffers.push_back(framebuffer);
+			if (i < bufferInfos.size())
+			{
+				descriptorWrites[i].dstBinding = bindings[i];
+				descriptorWrites[i].descriptorType = bindings[i] == 4 ? VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER : VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+				descriptorWrites[i].pBufferInfo = &bufferInfos[i];
+			}
+			else
+			{
+				descriptorWrites[i].dstBinding = 5;
+				descriptorWrites[i].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+				descriptorWrites[i].pImageInfo = &pyramidInfo;
+			}
 		}
 
-		Ref<Shader> shader = CreateRef<Shader>("basic");
-		s_Data.Resources->Shader = shader;
+		vkUpdateDescriptorSets(VulkanCore::Device(), descriptorWrites.size(), descriptorWrites.data(), 0, nullptr);
+	}
 
-		Ref<GraphicsPipeline> graphicsPipeline = CreateRef<GraphicsPipeline>(shader, descriptorSetLayout, s_Data.RenderPass, s_Data.Swapchain->Extent());
-		s_Data.GraphicsPipeline = graphicsPipeline;
+	static void ReserveGpuBuffers(uint32_t frame, uint32_t objectCount, uint32_t groupCount)
+	{
+		GpuFrameData& data = s_Data.GpuFrames[frame];
+		bool changed = false;
 
-		/* TODO:
-		* - Expose uniform memory
-		* - Remove as much stuff from s_Data (iteratively)
-		* - Implement basic API
-		* 
-		* - Start implementing deferred PBR rendering
-		*	- Have a look at what PBR rendering needs. Each parameter is probably a framebuffer in the GBuffer
-		*	- Store stuff in the G-Buffer:
-		*		- Positions
-		*		- Normals
-		*		- Color
-		*	- Do a depth only pass
-		*	- Fill the G-buffer: the vertex shader returns the necessary data to the fragment shader, which just outputs to the right attachments
-		*	- Draw the fullscreen quad: for each fragment, sample the previously filled attachments and do the necessary computations
-		
-		*/
+		// Only called after the frame's timeline value has been waited, so the old buffers aren't in use anymore
+		if (objectCount > data.ObjectCapacity || !data.Objects)
+		{
+			data.ObjectCapacity = std::max(std::max(objectCount, data.ObjectCapacity * 2), 1024u);
 
-		Ref<Mesh> mesh = CreateRef<Mesh>("../../Assets/Models/Sphere/sphere.obj");
-		s_Data.Resources->Mesh = mesh;
-		
-		CreateTextures();
-		CreateDescriptorSets();
+			data.Objects = CreateRef<Buffer>(data.ObjectCapacity * sizeof(GpuObjectData), BufferUsage::Storage);
+			data.Commands = CreateRef<Buffer>(data.ObjectCapacity * sizeof(VkDrawIndexedIndirectCommand), BufferUsage::Indirect);
+			data.Occluded = CreateRef<Buffer>(data.ObjectCapacity * sizeof(uint32_t), BufferUsage::DeviceStorage);
+			data.ObjectsMapped = (GpuObjectData*)data.Objects->Mapped();
+			changed = true;
+		}
 
-		// Init Synchronization
+		if (groupCount > data.GroupCapacity || !data.Groups)
 		{
-			Synchronization::Init(s_Config.MaxFramesInFlight);
-			Synchronization::CreateSemaphore("ImageAvailable");
-			Synchronization::CreateSemaphore("RenderFinished");
-			Synchronization::CreateFence("FrameInFlight");
+			data.GroupCapacity = std::max(std::max(groupCount, data.GroupCapacity * 2), 64u);
+
+			data.Groups = CreateRef<Buffer>(data.GroupCapacity * sizeof(GpuDrawGroup), BufferUsage::Storage);
+			data.Counts = CreateRef<Buffer>(data.GroupCapacity * sizeof(uint32_t), BufferUsage::Indirect);
+			data.GroupsMapped = (GpuDrawGroup*)data.Groups->Mapped();
+			changed = true;
 		}
 
-		// Init state
+		if (!data.Uniforms)
 		{
-			State::SetCurrentFrameIndex(0);
-			State::SetFramebuffer(s_Data.Framebuffers[0]);
+			data.Uniforms = CreateRef<Buffer>(sizeof(CullUniforms), BufferUsage::Uniform);
+			data.UniformsMapped = (CullUniforms*)data.Uniforms->Mapped();
+			changed = true;
 		}
-	}
-
-	void Renderer::Begin(const Camera& camera)
-	{
 
+		if (changed)
+			WriteGpuDescriptors(frame);
 	}
 
-	void Renderer::PushModel(Ref<Mesh> mesh, Ref<MaterialInstance> material, const glm::mat4& transform)
+	static void ReserveGpuLods(uint32_t slotCount)
 	{
-		Renderable r = { mesh, material, transform };
-		UUID materialID = material->ID();
+		if (slotCount <= s_Data.GpuLodCapacity && s_Data.GpuLods)
+			return;
 
-		if (s_Renderables.find(materialID) == s_Renderables.end())
-			s_Renderables[materialID] = std::vector<Renderable>();
-		s_Renderables[materialID].push_back(r);
-	}
-	
-	void Renderer::End()
-	{
-		Optimize();
-		PrepareResources();
-		DrawFrame();
-	}
+		// Shared by all the frames: none of them can be in use while it's replaced
+		Ref<Timeline> timeline = Synchronization::FrameTimeline();
+		timeline->Wait(timeline->Submitted());
 
-	void Renderer::Optimize()
-	{
+		// Never cleared: the selection ignores previous levels that don't make sense, so the history just starts over
+		s_Data.GpuLodCapacity = std::max(std::max(slotCount, s_Data.GpuLodCapacity * 2), 1024u);
+		s_Data.GpuLods = CreateRef<Buffer>(s_Data.GpuLodCapacity * sizeof(uint32_t), BufferUsage::DeviceStorage);
 
+		for (uint32_t i = 0; i < s_Data.GpuFrames.size(); i++)
+		{
+			if (s_Data.GpuFrames[i].Objects)
+				WriteGpuDescriptors(i);
+		}
 	}
 
-	void Renderer::PrepareResources()
+	static void CreateGpuResources()
 	{
-		UpdateUniformBuffer(State::CurrentFramebufferIndex());
+		DescriptorSetLayout cullSetLayout({
+			DescriptorSetBinding(DescriptorSetType::StorageBuffer, ShaderStage::Compute, 0, 1),
+			DescriptorSetBinding(DescriptorSetType::StorageBuffer, ShaderStage::Compute, 1, 1),
+			DescriptorSetBinding(DescriptorSetType::StorageBuffer, ShaderStage::Compute, 2, 1),
+			DescriptorSetBinding(DescriptorSetType::StorageBuffer, ShaderStage::Compute, 3, 1),
+			DescriptorSetBinding(DescriptorSetType::Buffer, ShaderStage::Compute, 4, 1),
+			DescriptorSetBinding(DescriptorSetType::Sampler, ShaderStage::Compute, 5, 1),
+			DescriptorSetBinding(DescriptorSetType::StorageBuffer, ShaderStage::Compute, 6, 1),
+			DescriptorSetBinding(DescriptorSetType::StorageBuffer, ShaderStage::Compute, 7, 1)
+		});
+		s_Data.CullDescriptorSetLayout = cullSetLayout;
+		s_Data.CullPipeline = CreateRef<ComputePipeline>(CreateRef<Shader>("cull", ShaderStage::Compute), cullSetLayout, sizeof(CullPushConstants));
+		// Compatible with the G-buffers, so the late draws use the same framebuffers and pipelines
+		s_Data.GeometryLatePass = CreateRef<RenderPass>(GBufferLateSpecs());
 
-		VkFence waits[] = { *Synchronization::GetFence("FrameInFlight") };
-		vkWaitForFences(VulkanCore::Device(), 1, waits, VK_TRUE, UINT64_MAX);
+		std::vector<VkDescriptorSetLayout> layouts(s_Config.MaxFramesInFlight, s_Data.CullDescriptorSetLayout);
+		VkDescriptorSetAllocateInfo allocateInfo = {};
+		allocateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+		allocateInfo.descriptorPool = s_Data.DescriptorPool;
+		allocateInfo.descriptorSetCount = s_Config.MaxFramesInFlight;
+		allocateInfo.pSetLayouts = layouts.data();
 
-		// Acquire next image
-		uint32_t imgIndex;
-		VkResult res = vkAcquireNextImageKHR(VulkanCore::Device(), *s_Data.Swapchain, UINT64_MAX,
-			*Synchronization::GetSemaphore("ImageAvailable"), VK_NULL_HANDLE, &imgIndex);
-		if (res != VK_SUCCESS)
-			throw std::runtime_error("Couldn't acquire image");
-		State::SetCurrentImageIndex(imgIndex);
+		s_Data.CullDescriptorSets.resize(s_Config.MaxFramesInFlight);
+		if (vkAllocateDescriptorSets(VulkanCore::Device(), &allocateInfo, s_Data.CullDescriptorSets.data()) != VK_SUCCESS)
+			throw std::runtime_error("Couldn't allocate culling descriptor sets");
 
-		// Reset everything
-		if (res == VK_ERROR_OUT_OF_DATE_KHR)
-		{
-			ResizeScreen();
-			return;
-		}
+		// The culling sets always point to a pyramid, even if occlusion culling is off and it's never built
+		s_Data.Pyramid = CreateRef<DepthPyramid>(s_Data.Extent.x, s_Data.Extent.y, s_Config.MaxFramesInFlight);
+		for (uint32_t i = 0; i < s_Config.MaxFramesInFlight; i++)
+			s_Data.Pyramid->SetSource(i, s_Data.GBuffers[i]->GetAttachment(AttachmentType::Depth, 0).ImageView);
 
-		vkResetFences(VulkanCore::Device(), 1, waits);
-		vkResetCommandBuffer(*s_Data.CommandBuffers[State::CurrentFramebufferIndex()], 0);
+		s_Data.GpuFrames.resize(s_Config.MaxFramesInFlight);
+		ReserveGpuLods(0);
+		for (uint32_t i = 0; i < s_Config.MaxFramesInFlight; i++)
+			ReserveGpuBuffers(i, 0, 0);
 	}
 
-	void Renderer::DrawFrame()
+	static void UploadGpuScene(RenderableRegistry& registry)
 	{
-		for (auto& batch : s_Renderables)
+		uint32_t frame = State::CurrentFramebufferIndex();
+		auto& batches = registry.Batches();
+
+		// Every (material, mesh) pair gets a group, and a region of the command buffer as big as its amount of objects
+		s_Data.GpuGroups.clear();
+		s_Data.GpuGroupIndices.clear();
+		s_Data.GpuObjectGroups.clear();
+		for (uint32_t b = 0; b < batches.size(); b++)
 		{
-			Ref<CommandBuffer> commandBuffer = s_Data.CommandBuffers[State::CurrentFramebufferIndex()];
-
-			State::BindCommandBuffer(commandBuffer);
-			commandBuffer->Begin();
-
-			s_Data.RenderPass->Begin(s_Data.GraphicsPipeline, s_Data.Swapchain->Extent());
+			RenderableBatch& batch = batches[b];
+			for (uint32_t i = 0; i < batch.Size(); i++)
 			{
-				VkBuffer buffers[] = { *s_Data.Resources->Mesh->VertexBuffer() };
-				VkDeviceSize offsets[] = { 0 };
+				uint64_t key = ((uint64_t)b << 32) | batch.MeshIDs[i];
+				auto it = s_Data.GpuGroupIndices.find(key);
+				uint32_t group;
 
-				// Draw models
+				if (it == s_Data.GpuGroupIndices.end())
 				{
-					for (auto& model : batch.second)
-					{
-						vkCmdBindVertexBuffers(*commandBuffer, 0, 1, buffers, offsets);
-						vkCmdBindIndexBuffer(*commandBuffer, *s_Data.Resources->Mesh->IndexBuffer(), 0, VK_INDEX_TYPE_UINT32);
-						vkCmdBindDescriptorSets(*commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, s_Data.GraphicsPipeline->Layout(), 0, 1,
-							&s_Data.DescriptorSets[State::CurrentFramebufferIndex()], 0, nullptr);
-
-						PushConsts consts;
-
-						consts.AO = 0.01f;
-						consts.Metallic = 0.5f;
-						consts.Roughness = 1.0f;
-						consts.CameraPos = glm::vec3(0.0f, 2, 2);
-
-						vkCmdPushConstants(*commandBuffer, s_Data.GraphicsPipeline->Layout(), VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(PushConsts), &consts);
-						vkCmdDrawIndexed(*commandBuffer, s_Data.Resources->Mesh->IndexBuffer()->Size() / sizeof(uint32_t), 1, 0, 0, 0);
-					}
+					group = s_Data.GpuGroups.size();
+					s_Data.GpuGroupIndices[key] = group;
+					s_Data.GpuGroups.push_back({ batch.Meshes[i].get(), 0, 0 });
 				}
-			}
-			s_Data.RenderPass->End();
-			commandBuffer->End();
-
-			// Get submitted command buffers
-			VkPipelineStageFlags waitStages[] = { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT };
-			std::vector<VkCommandBuffer> cmdBuffers(s_CommandBuffers.size());
-			for (uint32_t i = 0; i < cmdBuffers.size(); i++)
-				cmdBuffers[i] = *s_CommandBuffers[i];
-
-			VulkanCore::GraphicsQueue()->Submit({ commandBuffer });
-			VkResult res = VulkanCore::PresentQueue()->Present(s_Data.Swapchain);
-			
-			if (res == VK_ERROR_OUT_OF_DATE_KHR || res == VK_SUBOPTIMAL_KHR)
-			{
-				ResizeScreen();
-				return;
+				else
+					group = it->second;
+
+				s_Data.GpuGroups[group].Capacity++;
+				s_Data.GpuObjectGroups.push_back(group);
 			}
 		}
 
-		State::SetCurrentFrameIndex((State::CurrentFramebufferIndex() + 1) % s_Config.MaxFramesInFlight);
-		State::SetFramebuffer(s_Data.Framebuffers[State::CurrentImageIndex()]);
-		
-	}
+		s_Data.GpuObjectCount = s_Data.GpuObjectGroups.size();
+		ReserveGpuLods(registry.SlotCount());
+		ReserveGpuBuffers(frame, s_Data.GpuObjectCount, s_Data.GpuGroups.size());
+		GpuFrameData& data = s_Data.GpuFrames[frame];
+
+		uint32_t firstCommand = 0;
+		for (uint32_t g = 0; g < s_Data.GpuGroups.size(); g++)
+		{
+			GpuGroup& group = s_Data.GpuGroups[g];
+			group.FirstCommand = firstCommand;
+			firstCommand += group.Capacity;
+
+			GpuDrawGroup& dst = data.GroupsMapped[g];
+			dst.FirstCommand = group.FirstCommand;
+			dst.LodCount = group.Mesh->LodCount();
+			for (uint32_t l = 0; l < dst.LodCount; l++)
+				dst.Lods[l] = glm::uvec2(group.Mesh->Lod(l).FirstIndex, group.Mesh->Lod(l).IndexCount);
+		}
+
+		uint32_t object = 0;
+		for (auto& batch : batches)
+		{
+			for (uint32_t i = 0; i < batch.Size(); i++, object++)
+			{
+				GpuObjectData& dst = data.ObjectsMapped[object];
+				dst.Sphere = glm::vec4(batch.BoundsX[i], batch.BoundsY[i], batch.BoundsZ[i], batch.BoundsRadius[i]);
+				dst.Group = s_Data.GpuObjectGroups[object];
+				dst.Slot = batch.Owners[i];
+			}
+		}
+
+		// Objects are projected the same way the G-buffer was rendered, so that they line up with the pyramid
+		glm::mat4 projection = s_Data.Camera.Projection();
+		projection[1][1] *= -1;
+
+		CullUniforms& uniforms = *data.UniformsMapped;
+		Frustum frustum = Frustum::FromViewProjection(s_Data.Camera.ViewProjection());
+		for (uint32_t i = 0; i < 6; i++)
+			uniforms.Planes[i] = frustum.Planes[i];
+		uniforms.ViewProjection = projection * s_Data.Camera.View();
+		uniforms.PyramidSize = s_Data.Pyramid->Size();
+		uniforms.ObjectCount = s_Data.GpuObjectCount;
+		uniforms.Occlusion = s_Config.OcclusionCulling && s_Data.Pyramid->Valid();
+		uniforms.CameraPosition = glm::inverse(s_Data.Camera.View())[3];
+		uniforms.ProjectionScale = std::abs(s_Data.Camera.Projection()[1][1]);
+		uniforms.LodThreshold = s_Config.LodThreshold;
+		uniforms.LodHysteresis = s_Config.LodHysteresis;
+	}
+
+	static void CullOnGpu(CommandBuffer& commandBuffer, bool late)
+	{
+		uint32_t frame = State::CurrentFramebufferIndex();
+		GpuFrameData& data = s_Data.GpuFrames[frame];
+
+		if (s_Data.GpuGroups.empty())
+			return;
+
+		// The late phase reuses the commands and the counts of the early one, which the early draws may still be reading, and
+		// reads the occlusion flags the early one wrote
+		if (late)
+		{
+			VkMemoryBarrier flagsBarrier = {};
+			flagsBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+			flagsBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+			flagsBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+			vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+				VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &flagsBarrier, 0, nullptr, 0, nullptr);
+		}
+		// The level of detail history was last written by the previous frame's culling
+		else
+		{
+			VkMemoryBarrier lodsBarrier = {};
+			lodsBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+			lodsBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+			lodsBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+			vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &lodsBarrier,
+				0, nullptr, 0, nullptr);
+		}
+
+		// Counts start from zero every phase, the culling pass appends to them
+		vkCmdFillBuffer(commandBuffer, *data.Counts, 0, s_Data.GpuGroups.size() * sizeof(uint32_t), 0);
+
+		VkMemoryBarrier fillBarrier = {};
+		fillBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+		fillBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		fillBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &fillBarrier, 0, nullptr, 0, nullptr);
+
+		CullPushConstants consts;
+		consts.Late = late;
+
+		s_Data.CullPipeline->Bind(commandBuffer);
+		vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, s_Data.CullPipeline->Layout(), 0, 1,
+			&s_Data.CullDescriptorSets[frame], 0, nullptr);
+		vkCmdPushConstants(commandBuffer, s_Data.CullPipeline->Layout(), VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(CullPushConstants), &consts);
+		vkCmdDispatch(commandBuffer, (s_Data.GpuObjectCount + s_CullGroupSize - 1) / s_CullGroupSize, 1, 1);
+
+		// The draws can't start before the commands and the counts have been written
+		VkMemoryBarrier cullBarrier = {};
+		cullBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+		cullBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+		cullBarrier.dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT;
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT, 0, 1, &cullBarrier, 0, nullptr, 0, nullptr);
+	}
+
+	// Surface parameters written to the G-buffer, the same for every draw until materials provide their own
+	static void PushSurfaceConstants(VkCommandBuffer commandBuffer)
+	{
+		PushConsts consts;
+
+		consts.AO = 0.01f;
+		consts.Metallic = 0.5f;
+		consts.Roughness = 1.0f;
+
+		vkCmdPushConstants(commandBuffer, s_Data.GeometryPipeline->Layout(), VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(PushConsts), &consts);
+	}
+
+	static void DrawIndirect(CommandBuffer& commandBuffer)
+	{
+		uint32_t frame = State::CurrentFramebufferIndex();
+		GpuFrameData& data = s_Data.GpuFrames[frame];
+
+		BindGlobalDescriptors(commandBuffer);
+
+		PushSurfaceConstants(commandBuffer);
+
+		// One call per group, however many objects it contains: the GPU decides how many of them are drawn
+		for (uint32_t g = 0; g < s_Data.GpuGroups.size(); g++)
+		{
+			GpuGroup& group = s_Data.GpuGroups[g];
+
+			VkBuffer buffers[] = { *group.Mesh->VertexBuffer() };
+			VkDeviceSize offsets[] = { 0 };
+
+			vkCmdBindVertexBuffers(commandBuffer, 0, 1, buffers, offsets);
+			vkCmdBindIndexBuffer(commandBuffer, *group.Mesh->IndexBuffer(), 0, VK_INDEX_TYPE_UINT32);
+
+			vkCmdDrawIndexedIndirectCount(commandBuffer, *data.Commands, group.FirstCommand * sizeof(VkDrawIndexedIndirectCommand),
+				*data.Counts, g * sizeof(uint32_t), group.Capacity, sizeof(VkDrawIndexedIndirectCommand));
+		}
+	}
+
+	static void UpdateUniformBuffer(uint32_t currentImage)
+	{
+		UniformBufferObject ubo = {};
+		ubo.View = s_Data.Camera.View();
+		ubo.Projection = s_Data.Camera.Projection();
+		// Cameras use the OpenGL convention, Vulkan's clip space has Y pointing down
+		ubo.Projection[1][1] *= -1;
+
+		FrameAllocation camera = s_Data.FrameAllocators[currentImage]->Allocate(sizeof(UniformBufferObject));
+		memcpy(camera.Data, &ubo, sizeof(UniformBufferObject));
+
+		if (camera.Buffer != s_Data.CameraDescriptorBuffers[currentImage])
+			WriteCameraDescriptor(currentImage, camera.Buffer);
+		s_Data.CameraOffset = camera.Offset;
+	}
+	
+	static void CreateTextures()
+	{
+		s_Data.Resources->Texture = CreateRef<Texture>("../../Assets/Models/Sphere/Rusty/rustediron2_basecolor.png", VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_TILING_OPTIMAL);
+		s_Data.Resources->Roughness = CreateRef<Texture>("../../Assets/Models/Sphere/Rusty/rustediron2_metallic.png", VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_TILING_OPTIMAL);
+	}
+
+	static void CreateLightingResources()
+	{
+		DescriptorSetLayout lightingSetLayout({
+			DescriptorSetBinding(DescriptorSetType::Sampler, ShaderStage::Fragment, 0, 1),
+			DescriptorSetBinding(DescriptorSetType::Sampler, ShaderStage::Fragment, 1, 1),
+			DescriptorSetBinding(DescriptorSetType::Sampler, ShaderStage::Fragment, 2, 1),
+			DescriptorSetBinding(DescriptorSetType::Sampler, ShaderStage::Fragment, 3, 1),
+			DescriptorSetBinding(DescriptorSetType::Buffer, ShaderStage::Fragment, 4, 1),
+			DescriptorSetBinding(DescriptorSetType::StorageBuffer, ShaderStage::Fragment, 5, 1),
+			DescriptorSetBinding(DescriptorSetType::StorageBuffer, ShaderStage::Fragment, 6, 1),
+			DescriptorSetBinding(DescriptorSetType::StorageBuffer, ShaderStage::Fragment, 7, 1)
+		});
+		s_Data.LightingDescriptorSetLayout = lightingSetLayout;
+
+		DescriptorSetLayout clusterSetLayout({
+			DescriptorSetBinding(DescriptorSetType::Buffer, ShaderStage::Compute, 0, 1),
+			DescriptorSetBinding(DescriptorSetType::StorageBuffer, ShaderStage::Compute, 1, 1),
+			DescriptorSetBinding(DescriptorSetType::StorageBuffer, ShaderStage::Compute, 2, 1),
+			DescriptorSetBinding(DescriptorSetType::StorageBuffer, ShaderStage::Compute, 3, 1)
+		});
+		s_Data.ClusterDescriptorSetLayout = clusterSetLayout;
+		s_Data.ClusterPipeline = CreateRef<ComputePipeline>(CreateRef<Shader>("cluster", ShaderStage::Compute), clusterSetLayout, 0);
+
+		GraphicsPipelineConfig lightingConfig;
+		lightingConfig.VertexInput = false;
+		lightingConfig.DepthTest = false;
+		lightingConfig.CullMode = VK_CULL_MODE_NONE;
+		lightingConfig.PushConstantSize = sizeof(LightingPushConstants);
+		s_Data.LightingPipeline = CreateRef<GraphicsPipeline>(CreateRef<Shader>("lighting"), lightingSetLayout, s_Data.LightingPass,
+			s_Data.Extent, lightingConfig);
+
+		// The G-buffer has the size of the screen: pixels are read one to one
+		VkSamplerCreateInfo samplerInfo = {};
+		samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+		samplerInfo.magFilter = VK_FILTER_NEAREST;
+		samplerInfo.minFilter = VK_FILTER_NEAREST;
+		samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+		samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+		samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+		samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+		samplerInfo.borderColor = VK_BORDER_COLOR_INT_OPAQUE_BLACK;
+
+		if (vkCreateSampler(VulkanCore::Device(), &samplerInfo, nullptr, &s_Data.GBufferSampler) != VK_SUCCESS)
+			throw std::runtime_error("Couldn't create G-buffer sampler");
+
+		std::vector<VkDescriptorSetLayout> layouts(s_Config.MaxFramesInFlight, s_Data.LightingDescriptorSetLayout);
+		VkDescriptorSetAllocateInfo allocateInfo = {};
+		allocateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+		allocateInfo.descriptorPool = s_Data.DescriptorPool;
+		allocateInfo.descriptorSetCount = s_Config.MaxFramesInFlight;
+		allocateInfo.pSetLayouts = layouts.data();
+
+		s_Data.LightingDescriptorSets.resize(s_Config.MaxFramesInFlight);
+		if (vkAllocateDescriptorSets(VulkanCore::Device(), &allocateInfo, s_Data.LightingDescriptorSets.data()) != VK_SUCCESS)
+			throw std::runtime_error("Couldn't allocate lighting descriptor sets");
+
+		std::vector<VkDescriptorSetLayout> clusterLayouts(s_Config.MaxFramesInFlight, s_Data.ClusterDescriptorSetLayout);
+		allocateInfo.pSetLayouts = clusterLayouts.data();
+
+		s_Data.ClusterDescriptorSets.resize(s_Config.MaxFramesInFlight);
+		if (vkAllocateDescriptorSets(VulkanCore::Device(), &allocateInfo, s_Data.ClusterDescriptorSets.data()) != VK_SUCCESS)
+			throw std::runtime_error("Couldn't allocate light binning descriptor sets");
+
+		s_Data.LightFrames.resize(s_Config.MaxFramesInFlight);
+		for (uint32_t i = 0; i < s_Config.MaxFramesInFlight; i++)
+		{
+			WriteLightingDescriptors(i);
+			ReserveLightBuffers(i, 0);
+		}
+	}
+
+	static void UploadLights()
+	{
+		uint32_t frame = State::CurrentFramebufferIndex();
+		uint32_t count = s_Data.Lights.size();
+		ReserveLightBuffers(frame, count);
+
+		LightFrameData& data = s_Data.LightFrames[frame];
+		for (uint32_t i = 0; i < count; i++)
+		{
+			const PointLight& light = s_Data.Lights[i];
+			data.LightsMapped[i] = { glm::vec4(light.Position, light.Radius), glm::vec4(light.Color, 1.0f) };
+		}
+
+		glm::mat4 projection = s_Data.Camera.Projection();
+		projection[1][1] *= -1;
+		glm::mat4 inverseProjection = glm::inverse(projection);
+
+		// Depth range of the projection, whatever convention it was built with: view space points of the near and far planes
+		glm::vec4 nearPoint = inverseProjection * glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+		glm::vec4 farPoint = inverseProjection * glm::vec4(0.0f, 0.0f, 1.0f, 1.0f);
+
+		ClusterUniforms& uniforms = *data.UniformsMapped;
+		uniforms.InverseProjection = inverseProjection;
+		uniforms.View = s_Data.Camera.View();
+		uniforms.ScreenSize = s_Data.Extent;
+		uniforms.Near = -nearPoint.z / nearPoint.w;
+		uniforms.Far = -farPoint.z / farPoint.w;
+		uniforms.GridSize = glm::uvec4(ClusterGrid::TilesX, ClusterGrid::TilesY, ClusterGrid::Slices, count);
+	}
+
+	static void BinLights(VkCommandBuffer commandBuffer)
+	{
+		uint32_t frame = State::CurrentFramebufferIndex();
+
+		s_Data.ClusterPipeline->Bind(commandBuffer);
+		vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, s_Data.ClusterPipeline->Layout(), 0, 1,
+			&s_Data.ClusterDescriptorSets[frame], 0, nullptr);
+		vkCmdDispatch(commandBuffer, (ClusterGrid::Count + s_ClusterGroupSize - 1) / s_ClusterGroupSize, 1, 1);
+
+		// The lighting pass reads the clusters
+		VkMemoryBarrier binBarrier = {};
+		binBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+		binBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+		binBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 1, &binBarrier, 0, nullptr, 0, nullptr);
+	}
+
+	static void CreateStatisticsQueries()
+	{
+		if (!VulkanCore::SupportsPipelineStatistics())
+		{
+			std::cerr << "The device doesn't support inherited pipeline statistics queries, fragment invocations won't be reported" << std::endl;
+			return;
+		}
+
+		VkQueryPoolCreateInfo poolInfo = {};
+		poolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+		poolInfo.queryType = VK_QUERY_TYPE_PIPELINE_STATISTICS;
+		poolInfo.queryCount = s_Config.MaxFramesInFlight;
+		poolInfo.pipelineStatistics = s_StatisticsFlags;
+
+		if (vkCreateQueryPool(VulkanCore::Device(), &poolInfo, nullptr, &s_Data.StatisticsPool) != VK_SUCCESS)
+			throw std::runtime_error("Couldn't create pipeline statistics query pool");
+		s_Data.StatisticsWritten.assign(s_Config.MaxFramesInFlight, false);
+	}
+
+	static void ReadStatistics(VkCommandBuffer commandBuffer, uint32_t frame, RendererStats& stats)
+	{
+		if (s_Data.StatisticsPool == VK_NULL_HANDLE)
+			return;
+
+		// The frame's timeline value has been waited, so the results of its last use are available without stalling
+		uint64_t invocations;
+		if (s_Data.StatisticsWritten[frame] && vkGetQueryPoolResults(VulkanCore::Device(), s_Data.StatisticsPool, frame, 1, sizeof(uint64_t),
+			&invocations, sizeof(uint64_t), VK_QUERY_RESULT_64_BIT) == VK_SUCCESS)
+			stats.FragmentInvocations = invocations;
+
+		vkCmdResetQueryPool(commandBuffer, s_Data.StatisticsPool, frame, 1);
+	}
+
+	static void BeginStatistics(VkCommandBuffer commandBuffer, uint32_t frame)
+	{
+		if (s_Data.StatisticsPool != VK_NULL_HANDLE)
+			vkCmdBeginQuery(commandBuffer, s_Data.StatisticsPool, frame, 0);
+	}
+
+	static void EndStatistics(VkCommandBuffer commandBuffer, uint32_t frame)
+	{
+		if (s_Data.StatisticsPool == VK_NULL_HANDLE)
+			return;
+
+		vkCmdEndQuery(commandBuffer, s_Data.StatisticsPool, frame);
+		s_Data.StatisticsWritten[frame] = true;
+	}
+
+	void Renderer::Init(RendererConfig config, GLFWwindow* windowHandle)
+	{
+		int width, height;
+		if (config.Headless)
+		{
+			width = config.HeadlessWidth;
+			height = config.HeadlessHeight;
+		}
+		else
+			glfwGetWindowSize(windowHandle, &width, &height);
+
+		VulkanCoreConfig coreConfig;
+		for (uint32_t i = 0; i < config.ExtensionCount; i++)
+			coreConfig.UserExtensions.push_back(config.Extensions[i]);
+		coreConfig.WindowHandle = config.Headless ? nullptr : windowHandle;
+		coreConfig.MaxFramesInFlight = config.MaxFramesInFlight;
+		coreConfig.DynamicRendering = config.DynamicRendering;
+
+		s_Config = config;
+		s_Data.WindowHandle = windowHandle;
+		s_Data.Resources = new RendererResources();
+
+		VulkanCore::Init(coreConfig);
+		ThreadPool::Init();
+
+		if (s_Config.GpuDriven && !VulkanCore::SupportsIndirectCount())
+		{
+			std::cerr << "The device doesn't support indirect count draws, falling back to CPU culling" << std::endl;
+			s_Config.GpuDriven = false;
+		}
+		if (s_Config.DynamicRendering && !VulkanCore::DynamicRendering())
+		{
+			std::cerr << "The device doesn't support dynamic rendering, falling back to render pass objects" << std::endl;
+			s_Config.DynamicRendering = false;
+		}
+		if (s_Config.OcclusionCulling && !s_Config.GpuDriven)
+		{
+			std::cerr << "Occlusion culling requires the GPU driven path, disabling it" << std::endl;
+			s_Config.OcclusionCulling = false;
+		}
+		
+		s_Data.GraphicsQueue = VulkanCore::GraphicsQueue();
+		s_Data.PresentationQueue = VulkanCore::PresentQueue();
+
+		if (s_Config.Headless)
+		{
+			s_Data.Extent = glm::vec2(width, height);
+			s_Data.FramebufferWidth = width;
+			s_Data.FramebufferHeight = height;
+		}
+		else
+		{
+			s_Data.Swapchain = CreateRef<Swapchain>(width, height);
+			s_Data.Extent = s_Data.Swapchain->Extent();
+
+			int framebufferWidth, framebufferHeight;
+			glfwGetFramebufferSize(windowHandle, &framebufferWidth, &framebufferHeight);
+			s_Data.FramebufferWidth = framebufferWidth;
+			s_Data.FramebufferHeight = framebufferHeight;
+			glfwSetFramebufferSizeCallback(windowHandle, OnFramebufferResize);
+		}
+
+		// DescriptorSetType type, DescriptorStageFlags stage, uint32_t binding, uint32_t amount
+		std::vector<DescriptorSetBinding> bindings = {
+			DescriptorSetBinding(DescriptorSetType::DynamicBuffer, ShaderStage::Vertex, 0, 1),
+			DescriptorSetBinding(DescriptorSetType::Sampler, ShaderStage::Fragment, 1, 1),
+			DescriptorSetBinding(DescriptorSetType::Sampler, ShaderStage::Fragment, 2, 1),
+			DescriptorSetBinding(DescriptorSetType::DynamicStorageBuffer, ShaderStage::Vertex, 3, 1)
+		};
+
+		DescriptorSetLayout descriptorSetLayout(bindings);
+		s_Data.DescriptorSetLayout = descriptorSetLayout;
+		s_Data.DescriptorPool = *VulkanCore::DescriptorPool();
+
+		CreateFrameAllocators();
+
+		s_Data.CommandPool = CreateRef<CommandPool>(Support::GetQueueFamilyIndices(VulkanCore::PhysicalDevice(), VulkanCore::Surface()));
+		ImmediateCommands::Init();
+
+		// Init Synchronization: uploads and the growth of the object ring already wait on the frame timeline
+		{
+			Synchronization::Init(s_Config.MaxFramesInFlight);
+			Synchronization::CreateSemaphore("ImageAvailable");
+			Synchronization::CreateSemaphore("RenderFinished");
+			s_Data.FrameValues.resize(s_Config.MaxFramesInFlight, 0);
+		}
+		StagingRing::Init(s_Config.StagingRingSize);
+		TransferCommands::Init();
+
+		std::vector<Ref<CommandBuffer>> commandBuffers = s_Data.CommandPool->AllocateCommandBuffers(s_Config.MaxFramesInFlight);
+		for (auto& buf : commandBuffers)
+			s_Data.CommandBuffers.push_back(buf);
+
+		s_Data.RecordingPools.resize(s_Config.MaxFramesInFlight);
+		s_Data.SecondaryBuffers.resize(s_Config.MaxFramesInFlight);
+		s_Data.PrepassBuffers.resize(s_Config.MaxFramesInFlight);
+		for (uint32_t i = 0; i < s_Config.MaxFramesInFlight; i++)
+		{
+			for (uint32_t t = 0; t < ThreadPool::ThreadCount(); t++)
+			{
+				Ref<CommandPool> pool = CreateRef<CommandPool>(Support::GetQueueFamilyIndices(VulkanCore::PhysicalDevice(), VulkanCore::Surface()));
+				std::vector<Ref<CommandBuffer>> buffers = pool->AllocateCommandBuffers(2, VK_COMMAND_BUFFER_LEVEL_SECONDARY);
+				s_Data.SecondaryBuffers[i].push_back(buffers[0]);
+				s_Data.PrepassBuffers[i].push_back(buffers[1]);
+				s_Data.RecordingPools[i].push_back(pool);
+			}
+		}
+
+		std::vector<FramebufferAttachmentSpecs> gBufferSpecs = GBufferSpecs();
+		std::vector<FramebufferAttachmentSpecs> outputSpecs = OutputSpecs();
+		s_Data.GeometryPass = CreateRef<RenderPass>(gBufferSpecs);
+		s_Data.LightingPass = CreateRef<RenderPass>(outputSpecs);
+
+		// Frames in flight overlap, so each of them needs its own G-buffer
+		for (uint32_t i = 0; i < s_Config.MaxFramesInFlight; i++)
+			s_Data.GBuffers.push_back(CreateRef<Framebuffer>(*s_Data.GeometryPass, width, height, gBufferSpecs,
+				std::vector<VkImage>(gBufferSpecs.size(), VK_NULL_HANDLE)));
+
+		uint32_t framebufferCount = s_Config.Headless ? s_Config.MaxFramesInFlight : s_Data.Swapchain->Images().size();
+		for (uint32_t i = 0; i < framebufferCount; i++)
+		{
+			std::vector<VkImage> images;
+			for (auto spec : outputSpecs)
+				if (spec.IsSwapchain)
+					images.push_back(s_Data.Swapchain->Images()[i]);
+				else
+					images.push_back(VK_NULL_HANDLE);
+
+			Ref<Framebuffer> framebuffer = CreateRef<Framebuffer>(*s_Data.LightingPass, width, height, outputSpecs, images);
+			s_Data.Framebuffers.push_back(framebuffer);
+		}
+
+		GpuProfiler::Init(s_Config.MaxFramesInFlight);
+		CreateStatisticsQueries();
+
+		if (s_Config.Headless && s_Config.HeadlessReadback)
+			for (uint32_t i = 0; i < s_Config.MaxFramesInFlight; i++)
+				s_Data.Readbacks.push_back(CreateRef<Buffer>(width * height * 4, BufferUsage::TransferDst));
+
+		Ref<Shader> shader = s_Config.GpuDriven ? CreateRef<Shader>("indirect", "gbuffer") : CreateRef<Shader>("basic", "gbuffer");
+		s_Data.Resources->Shader = shader;
+
+		GraphicsPipelineConfig geometryConfig;
+		geometryConfig.ColorAttachments = 3;
+		s_Data.GeometryPipeline = CreateRef<GraphicsPipeline>(shader, descriptorSetLayout, s_Data.GeometryPass, s_Data.Extent, geometryConfig);
+
+		// Both variants are always there, so that the prepass can be toggled between scenes for free. The prepass runs in the
+		// geometry pass, so it has to declare its color attachments even though it doesn't write them
+		GraphicsPipelineConfig prepassConfig = geometryConfig;
+		prepassConfig.PositionOnly = true;
+		Ref<Shader> depthShader = CreateRef<Shader>(s_Config.GpuDriven ? "depth_indirect" : "depth", ShaderStage::Vertex);
+		s_Data.DepthPrepassPipeline = CreateRef<GraphicsPipeline>(depthShader, descriptorSetLayout, s_Data.GeometryPass, s_Data.Extent, prepassConfig);
+
+		GraphicsPipelineConfig equalConfig = geometryConfig;
+		equalConfig.DepthWrite = false;
+		equalConfig.DepthCompareOp = VK_COMPARE_OP_EQUAL;
+		s_Data.GeometryEqualPipeline = CreateRef<GraphicsPipeline>(shader, descriptorSetLayout, s_Data.GeometryPass, s_Data.Extent, equalConfig);
+
+		CreateLightingResources();
+
+		/* TODO:
+		* - Expose uniform memory
+		* - Remove as much stuff from s_Data (iteratively)
+		* - Implement basic API
+		*/
+
+		// One submission for all the default resources. The frames are submitted after it on the same queue, no need to wait
+		ImmediateCommands::BeginBatch();
+		Ref<Mesh> mesh = CreateRef<Mesh>("../../Assets/Models/Sphere/sphere.obj");
+		s_Data.Resources->Mesh = mesh;
+		
+		CreateTextures();
+		ImmediateCommands::EndBatch();
+		CreateDescriptorSets();
+		ReserveObjectRing(0);
+		if (s_Config.GpuDriven)
+			CreateGpuResources();
+
+		// Init state
+		{
+			State::SetCurrentFrameIndex(0);
+			State::SetFramebuffer(s_Data.Framebuffers[0]);
+		}
+
+		// Packets are built by the application and drawn either in End or by the render thread
+		s_Packet = &s_RenderThread.Packets[0];
+		if (s_Config.RenderThread)
+		{
+			s_RenderThread.Free.Push(&s_RenderThread.Packets[1]);
+			s_RenderThread.Thread = std::thread(RenderLoop);
+		}
+	}
+
+	static void UploadInstances(RenderableRegistry& registry)
+	{
+		uint32_t count = s_Data.DrawList.size();
+		s_Data.Instances = s_Data.FrameAllocators[State::CurrentFramebufferIndex()]->Allocate(std::max(count, 1u) * sizeof(InstanceData));
+
+		// Instances are stored in draw order, so that every instanced draw reads a contiguous range
+		InstanceData* instances = (InstanceData*)s_Data.Instances.Data;
+		auto& batches = registry.Batches();
+		for (uint32_t i = 0; i < count; i++)
+		{
+			const DrawItem& item = s_Data.DrawList[i];
+			instances[i].ObjectIndex = batches[item.Batch].Owners[item.Index];
+		}
+	}
+
+	static void RecordDraws(CommandBuffer& commandBuffer, Ref<GraphicsPipeline> pipeline, uint32_t begin, uint32_t end)
+	{
+		VkQueryPipelineStatisticFlags statistics = s_Data.StatisticsPool != VK_NULL_HANDLE ? s_StatisticsFlags : 0;
+		commandBuffer.BeginSecondary(*s_Data.GeometryPass, *s_Data.GBuffers[State::CurrentFramebufferIndex()], statistics);
+
+		// Nothing is inherited from the primary buffer: every secondary buffer sets up its own state
+		pipeline->Bind(commandBuffer);
+		RenderPass::SetViewport(commandBuffer, s_Data.Extent);
+
+		BindGlobalDescriptors(commandBuffer);
+
+		PushSurfaceConstants(commandBuffer);
+
+		vkCmdBindVertexBuffers(commandBuffer, 1, 1, &s_Data.Instances.Buffer, &s_Data.Instances.Offset);
+
+		Mesh* boundMesh = nullptr;
+
+		// Follow the order computed in Optimize
+		for (uint32_t i = begin; i < end; i++)
+		{
+			const InstancedDraw& draw = s_Data.InstancedDraws[i];
+
+			// Only rebind geometry when it actually changes
+			if (draw.Mesh != boundMesh)
+			{
+				VkBuffer buffers[] = { *draw.Mesh->VertexBuffer() };
+				VkDeviceSize offsets[] = { 0 };
+
+				vkCmdBindVertexBuffers(commandBuffer, 0, 1, buffers, offsets);
+				vkCmdBindIndexBuffer(commandBuffer, *draw.Mesh->IndexBuffer(), 0, VK_INDEX_TYPE_UINT32);
+				boundMesh = draw.Mesh;
+			}
+
+			// Every level lives in the same index buffer
+			const MeshLod& lod = draw.Mesh->Lod(draw.Lod);
+			vkCmdDrawIndexed(commandBuffer, lod.IndexCount, draw.InstanceCount, lod.FirstIndex, 0, draw.FirstInstance);
+		}
+
+		commandBuffer.End();
+	}
+
+	static void DrawGpuGeometry(CommandBuffer& commandBuffer, Ref<RenderPass> renderPass, bool prepass, Ref<GraphicsPipeline> geometryPipeline)
+	{
+		uint32_t frame = State::CurrentFramebufferIndex();
+
+		// The prepass writes the depth in the same subpass: the geometry pipeline only passes the fragments matching it
+		if (prepass)
+		{
+			renderPass->Begin(*s_Data.GBuffers[frame], s_Data.DepthPrepassPipeline, s_Data.Extent);
+			DrawIndirect(commandBuffer);
+			geometryPipeline->Bind(commandBuffer);
+		}
+		else
+			renderPass->Begin(*s_Data.GBuffers[frame], geometryPipeline, s_Data.Extent);
+		DrawIndirect(commandBuffer);
+		renderPass->End();
+	}
+
+	static void BuildDepthPyramid(VkCommandBuffer commandBuffer)
+	{
+		uint32_t frame = State::CurrentFramebufferIndex();
+		Ref<Framebuffer> gBuffer = s_Data.GBuffers[frame];
+
+		VkImageMemoryBarrier depthBarrier = {};
+		depthBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+		depthBarrier.srcAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+		depthBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+		depthBarrier.oldLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+		depthBarrier.newLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
+		depthBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		depthBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		depthBarrier.image = gBuffer->GetAttachment(AttachmentType::Depth, 0).Image;
+		depthBarrier.subresourceRange = { VK_IMAGE_ASPECT_DEPTH_BIT, 0, 1, 0, 1 };
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0,
+			0, nullptr, 0, nullptr, 1, &depthBarrier);
+
+		s_Data.Pyramid->Build(commandBuffer, frame);
+
+		// Back to an attachment for the late geometry pass, which also loads the colors the early one wrote
+		depthBarrier.srcAccessMask = VK_ACCESS_SHADER_READ_BIT;
+		depthBarrier.dstAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+		depthBarrier.oldLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
+		depthBarrier.newLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+			VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT, 0, 0, nullptr, 0, nullptr, 1, &depthBarrier);
+
+		VkMemoryBarrier colorBarrier = {};
+		colorBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+		colorBarrier.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+		colorBarrier.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, 0,
+			1, &colorBarrier, 0, nullptr, 0, nullptr);
+	}
+
+	static void TransitionGBuffer(VkCommandBuffer commandBuffer)
+	{
+		Ref<Framebuffer> gBuffer = s_Data.GBuffers[State::CurrentFramebufferIndex()];
+
+		// The geometry pass leaves the G-buffer as attachments, the lighting pass samples it
+		std::array<VkImageMemoryBarrier, 4> barriers = {};
+		for (uint32_t i = 0; i < barriers.size(); i++)
+		{
+			bool depth = i == 3;
+
+			barriers[i].sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+			barriers[i].srcAccessMask = depth ? VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT : VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+			barriers[i].dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+			barriers[i].oldLayout = depth ? VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL : VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+			barriers[i].newLayout = depth ? VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL : VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+			barriers[i].srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+			barriers[i].dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+			barriers[i].image = depth ? gBuffer->GetAttachment(AttachmentType::Depth, 0).Image : gBuffer->GetAttachment(AttachmentType::Color, i).Image;
+			barriers[i].subresourceRange = { (VkImageAspectFlags)(depth ? VK_IMAGE_ASPECT_DEPTH_BIT : VK_IMAGE_ASPECT_COLOR_BIT), 0, 1, 0, 1 };
+		}
+
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
+			VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0, nullptr, 0, nullptr, barriers.size(), barriers.data());
+	}
+
+	static void DrawLighting(VkCommandBuffer commandBuffer)
+	{
+		// Same projection as the one the G-buffer was rendered with
+		glm::mat4 projection = s_Data.Camera.Projection();
+		projection[1][1] *= -1;
+		glm::mat4 view = s_Data.Camera.View();
+
+		LightingPushConstants consts;
+		consts.InverseViewProjection = glm::inverse(projection * view);
+		consts.CameraPosition = glm::inverse(view)[3];
+
+		s_Data.LightingPass->Begin(s_Data.LightingPipeline, s_Data.Extent);
+		vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, s_Data.LightingPipeline->Layout(), 0, 1,
+			&s_Data.LightingDescriptorSets[State::CurrentFramebufferIndex()], 0, nullptr);
+		vkCmdPushConstants(commandBuffer, s_Data.LightingPipeline->Layout(), VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(LightingPushConstants), &consts);
+
+		// Fullscreen triangle, generated by lighting.vert
+		vkCmdDraw(commandBuffer, 3, 1, 0, 0);
+		s_Data.LightingPass->End();
+	}
+
+	static void CopyToReadback(VkCommandBuffer commandBuffer)
+	{
+		VkImage image = State::Framebuffer()->GetAttachment(AttachmentType::Color, 0).Image;
+		VkBuffer readback = *s_Data.Readbacks[State::CurrentFramebufferIndex()];
+
+		// The render pass leaves the target as a color attachment
+		VkImageMemoryBarrier toTransfer = {};
+		toTransfer.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+		toTransfer.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+		toTransfer.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+		toTransfer.oldLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+		toTransfer.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+		toTransfer.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		toTransfer.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		toTransfer.image = image;
+		toTransfer.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 };
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
+			0, nullptr, 0, nullptr, 1, &toTransfer);
+
+		VkBufferImageCopy region = {};
+		region.imageSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1 };
+		region.imageExtent = { (uint32_t)s_Data.Extent.x, (uint32_t)s_Data.Extent.y, 1 };
+		vkCmdCopyImageToBuffer(commandBuffer, image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, readback, 1, &region);
+
+		VkBufferMemoryBarrier toHost = {};
+		toHost.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+		toHost.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		toHost.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+		toHost.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		toHost.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		toHost.buffer = readback;
+		toHost.offset = 0;
+		toHost.size = VK_WHOLE_SIZE;
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0,
+			0, nullptr, 1, &toHost, 0, nullptr);
+	}
+
+	void Renderer::Begin(const Camera& camera)
+	{
+		s_Packet->Camera = camera;
+		s_Packet->DepthPrepass = s_Config.DepthPrepass;
+	}
+
+	void Renderer::PushModel(Ref<Mesh> mesh, Ref<MaterialInstance> material, const glm::mat4& transform)
+	{
+		RenderableHandle handle = s_Handles.Allocate();
+		s_Packet->Commands.push_back({ RenderCommandType::Add, handle, mesh, material, transform });
+		s_Packet->Transients.push_back(handle);
+	}
+	
+	void Renderer::PushLight(const PointLight& light)
+	{
+		s_Packet->Lights.push_back(light);
+	}
+
+	void Renderer::End()
+	{
+		// Immediate mode models only live for the frame they were pushed in. Packets are drawn in order, so the handles can
+		// already be reused by the next one
+		for (auto handle : s_Packet->Transients)
+			s_Handles.Free(handle);
+
+		if (!s_Config.RenderThread)
+		{
+			RenderPacket(*s_Packet);
+			s_Packet->Clear();
+			return;
+		}
+
+		// Hand the packet over and get the other one back: only blocks if the previous frame is still being drawn
+		s_RenderThread.Submitted.Push(s_Packet);
+		s_RenderThread.Free.Pop(s_Packet);
+	}
+
+	void Renderer::SetDepthPrepass(bool enabled)
+	{
+		// Only read by the application thread, the render thread gets the value through the packets
+		s_Config.DepthPrepass = enabled;
+	}
+
+	RenderableHandle Renderer::AddRenderable(Ref<Mesh> mesh, Ref<MaterialInstance> material, const glm::mat4& transform)
+	{
+		RenderableHandle handle = s_Handles.Allocate();
+		s_Packet->Commands.push_back({ RenderCommandType::Add, handle, mesh, material, transform });
+		return handle;
+	}
+
+	void Renderer::UpdateTransform(RenderableHandle handle, const glm::mat4& transform)
+	{
+		s_Packet->Commands.push_back({ RenderCommandType::UpdateTransform, handle, nullptr, nullptr, transform });
+	}
+
+	void Renderer::RemoveRenderable(RenderableHandle handle)
+	{
+		if (s_Handles.Free(handle))
+			s_Packet->Commands.push_back({ RenderCommandType::Remove, handle, nullptr, nullptr, glm::mat4(1.0f) });
+	}
+
+	RendererStats Renderer::Stats()
+	{
+		std::lock_guard<std::mutex> lock(s_RenderThread.StatsMutex);
+		return s_RenderThread.PublishedStats;
+	}
+
+	void Renderer::RenderPacket(FramePacket& packet)
+	{
+		for (auto& command : packet.Commands)
+		{
+			switch (command.Type)
+			{
+			case RenderCommandType::Add:				s_Registry.Add(command.Handle, command.Mesh, command.Material, command.Transform); break;
+			case RenderCommandType::UpdateTransform:	s_Registry.UpdateTransform(command.Handle, command.Transform); break;
+			case RenderCommandType::Remove:				s_Registry.Remove(command.Handle); break;
+			default: break;
+			}
+		}
+		s_Data.Camera = packet.Camera;
+		s_Data.Lights.assign(packet.Lights.begin(), packet.Lights.end());
+		s_Data.DepthPrepass = packet.DepthPrepass;
+
+		if (s_Data.FramebufferResized.exchange(false))
+			ResizeScreen();
+
+		// Minimized: there's nothing to draw to
+		if (s_Data.FramebufferWidth != 0 && s_Data.FramebufferHeight != 0)
+		{
+			auto optimizeStart = std::chrono::high_resolution_clock::now();
+			Optimize();
+			auto prepareStart = std::chrono::high_resolution_clock::now();
+			bool prepared = PrepareResources();
+			auto drawStart = std::chrono::high_resolution_clock::now();
+			if (prepared)
+				DrawFrame();
+			auto drawEnd = std::chrono::high_resolution_clock::now();
+
+			s_Stats.OptimizeTime = std::chrono::duration<float, std::milli>(prepareStart - optimizeStart).count();
+			s_Stats.PrepareTime = std::chrono::duration<float, std::milli>(drawStart - prepareStart).count();
+			s_Stats.DrawTime = std::chrono::duration<float, std::milli>(drawEnd - drawStart).count();
+		}
+
+		for (auto handle : packet.Transients)
+			s_Registry.Remove(handle);
+
+		std::lock_guard<std::mutex> lock(s_RenderThread.StatsMutex);
+		s_RenderThread.PublishedStats = s_Stats;
+	}
+
+	void Renderer::RenderLoop()
+	{
+		FramePacket* packet;
+		while (s_RenderThread.Submitted.Pop(packet))
+		{
+			RenderPacket(*packet);
+			packet->Clear();
+			s_RenderThread.Free.Push(packet);
+		}
+	}
+
+	// Fraction of the screen height covered by a bounding sphere
+	static float ScreenCoverage(const glm::vec3& center, float radius, const glm::vec3& cameraPosition, float projectionScale)
+	{
+		float distance = std::max(glm::length(center - cameraPosition), radius);
+		return radius * projectionScale / std::max(distance, 0.0001f);
+	}
+
+	// Level l is drawn while the coverage is above LodThreshold / 2^l, the last level below. The previous level is kept as long
+	// as the coverage stays within the hysteresis band around the thresholds, so that objects don't flicker between two levels.
+	// Same selection as cull.comp
+	static uint32_t SelectLod(float coverage, uint32_t lodCount, uint32_t previous)
+	{
+		auto level = [lodCount](float coverage)
+		{
+			uint32_t lod = 0;
+			for (float threshold = s_Config.LodThreshold; lod + 1 < lodCount && coverage < threshold; threshold *= 0.5f)
+				lod++;
+			return lod;
+		};
+
+		uint32_t finest = level(coverage * (1.0f + s_Config.LodHysteresis));
+		uint32_t coarsest = level(coverage * (1.0f - s_Config.LodHysteresis));
+		return previous >= finest && previous <= coarsest ? previous : level(coverage);
+	}
+
+	void Renderer::Optimize()
+	{
+		// Culling and ordering happen on the GPU, objects are uploaded in PrepareResources
+		if (s_Config.GpuDriven)
+		{
+			s_Stats.VisibleRenderables = s_Registry.Count();
+			s_Stats.CulledRenderables = 0;
+			s_Stats.CullingTime = 0.0f;
+			s_Stats.SortingTime = 0.0f;
+			s_Stats.Triangles = 0;
+			return;
+		}
+
+		glm::mat4 view = s_Data.Camera.View();
+		glm::vec3 cameraPosition = glm::inverse(view)[3];
+		float projectionScale = std::abs(s_Data.Camera.Projection()[1][1]);
+		Frustum frustum = Frustum::FromViewProjection(s_Data.Camera.ViewProjection());
+		auto& batches = s_Registry.Batches();
+
+		s_Data.DrawList.clear();
+		s_Data.DrawList.reserve(s_Registry.Count());
+
+		auto cullStart = std::chrono::high_resolution_clock::now();
+		for (uint32_t b = 0; b < batches.size(); b++)
+		{
+			RenderableBatch& batch = batches[b];
+
+			s_Data.Visible.clear();
+			s_Data.Culler.Cull(frustum, batch.BoundsX.data(), batch.BoundsY.data(), batch.BoundsZ.data(), batch.BoundsRadius.data(),
+				batch.Size(), s_Data.Visible);
+
+			for (uint32_t i : s_Data.Visible)
+			{
+				// Distance along the view direction of the center of the bounds
+				float viewDepth = -(view[0][2] * batch.BoundsX[i] + view[1][2] * batch.BoundsY[i] + view[2][2] * batch.BoundsZ[i] + view[3][2]);
+
+				glm::vec3 center(batch.BoundsX[i], batch.BoundsY[i], batch.BoundsZ[i]);
+				float coverage = ScreenCoverage(center, batch.BoundsRadius[i], cameraPosition, projectionScale);
+				uint32_t lod = SelectLod(coverage, batch.Meshes[i]->LodCount(), batch.Lods[i]);
+				batch.Lods[i] = lod;
+
+				// Every opaque draw goes through the geometry pipeline
+				const uint32_t pipeline = 0;
+				s_Data.DrawList.push_back({ DrawSorter::MakeKey(DrawPass::Opaque, pipeline, b, batch.MeshIDs[i], lod, viewDepth), b, i });
+			}
+		}
+		auto sortStart = std::chrono::high_resolution_clock::now();
+
+		s_Data.Sorter.Sort(s_Data.DrawList);
+		auto sortEnd = std::chrono::high_resolution_clock::now();
+
+		// Sorting puts draws sharing material, mesh and level of detail next to each other: each run becomes a single instanced draw
+		s_Data.InstancedDraws.clear();
+		s_Stats.Triangles = 0;
+		for (uint32_t i = 0; i < s_Data.DrawList.size(); i++)
+		{
+			const DrawItem& item = s_Data.DrawList[i];
+			Mesh* mesh = batches[item.Batch].Meshes[item.Index].get();
+			uint32_t lod = batches[item.Batch].Lods[item.Index];
+			s_Stats.Triangles += mesh->Lod(lod).IndexCount / 3;
+
+			InstancedDraw* last = s_Data.InstancedDraws.empty() ? nullptr : &s_Data.InstancedDraws.back();
+			if (last && last->Batch == item.Batch && last->Mesh == mesh && last->Lod == lod)
+				last->InstanceCount++;
+			else
+				s_Data.InstancedDraws.push_back({ mesh, lod, item.Batch, i, 1 });
+		}
+
+		s_Stats.VisibleRenderables = s_Data.DrawList.size();
+		s_Stats.CulledRenderables = s_Registry.Count() - s_Stats.VisibleRenderables;
+		s_Stats.DrawCalls = s_Data.InstancedDraws.size();
+		s_Stats.CullingTime = std::chrono::duration<float, std::milli>(sortStart - cullStart).count();
+		s_Stats.SortingTime = std::chrono::duration<float, std::milli>(sortEnd - sortStart).count();
+	}
+
+	bool Renderer::PrepareResources()
+	{
+		Synchronization::FrameTimeline()->Wait(s_Data.FrameValues[State::CurrentFramebufferIndex()]);
+
+		// Acquire next image
+		uint32_t imgIndex;
+		if (s_Config.Headless)
+		{
+			// One offscreen target per frame in flight: the wait above guarantees it's not in use anymore
+			imgIndex = State::CurrentFramebufferIndex();
+			State::SetCurrentImageIndex(imgIndex);
+			State::SetFramebuffer(s_Data.Framebuffers[imgIndex]);
+		}
+		else
+		{
+			VkResult res = vkAcquireNextImageKHR(VulkanCore::Device(), *s_Data.Swapchain, UINT64_MAX,
+				*Synchronization::GetSemaphore("ImageAvailable"), VK_NULL_HANDLE, &imgIndex);
+
+			// Expected after a resize: reset everything and skip the frame. Suboptimal images can still be presented
+			if (res == VK_ERROR_OUT_OF_DATE_KHR)
+			{
+				ResizeScreen();
+				return false;
+			}
+			if (res != VK_SUCCESS && res != VK_SUBOPTIMAL_KHR)
+				throw std::runtime_error("Couldn't acquire image");
+
+			State::SetCurrentImageIndex(imgIndex);
+			State::SetFramebuffer(s_Data.Framebuffers[imgIndex]);
+		}
+
+		// The frame's buffers are free to be written now that its timeline value has been waited
+		s_Data.FrameAllocators[State::CurrentFramebufferIndex()]->Reset();
+		UpdateUniformBuffer(State::CurrentFramebufferIndex());
+		UploadLights();
+		UploadObjects(s_Registry);
+		if (s_Config.GpuDriven)
+			UploadGpuScene(s_Registry);
+		else
+			UploadInstances(s_Registry);
+		vkResetCommandBuffer(*s_Data.CommandBuffers[State::CurrentFramebufferIndex()], 0);
+
+		return true;
+	}
+
+	void Renderer::DrawFrame()
+	{
+		Ref<CommandBuffer> commandBuffer = s_Data.CommandBuffers[State::CurrentFramebufferIndex()];
+
+		State::BindCommandBuffer(commandBuffer);
+		commandBuffer->Begin();
+		// Takes ownership of the uploads made on the transfer queue since the last frame
+		uint64_t transferValue = TransferCommands::Acquire(*commandBuffer);
+		// Collects the timings of the last use of this frame in flight
+		GpuProfiler::BeginFrame(*commandBuffer, State::CurrentFramebufferIndex());
+		s_Stats.GpuTime = GpuProfiler::ScopeTime("Frame");
+		ReadStatistics(*commandBuffer, State::CurrentFramebufferIndex(), s_Stats);
+		GpuProfiler::BeginScope(*commandBuffer, "Frame");
+
+		// Lights don't depend on the geometry, they're binned first so the lighting pass doesn't wait for them
+		GpuProfiler::BeginScope(*commandBuffer, "Light binning");
+		BinLights(*commandBuffer);
+		GpuProfiler::EndScope(*commandBuffer);
+
+		// Every batch is recorded in the same geometry pass, so the frame is submitted and presented exactly once
+		uint32_t frame = State::CurrentFramebufferIndex();
+		bool prepass = s_Data.DepthPrepass;
+		Ref<GraphicsPipeline> geometryPipeline = prepass ? s_Data.GeometryEqualPipeline : s_Data.GeometryPipeline;
+		if (s_Config.GpuDriven)
+		{
+			auto recordStart = std::chrono::high_resolution_clock::now();
+
+			// Compute work can't be recorded inside a render pass. With occlusion culling, the early phase tests the objects
+			// against the pyramid of the previous frame
+			GpuProfiler::BeginScope(*commandBuffer, "Cull");
+			CullOnGpu(*commandBuffer, false);
+			GpuProfiler::EndScope(*commandBuffer);
+
+			GpuProfiler::BeginScope(*commandBuffer, "Geometry pass");
+			BeginStatistics(*commandBuffer, frame);
+			DrawGpuGeometry(*commandBuffer, s_Data.GeometryPass, prepass, geometryPipeline);
+			GpuProfiler::EndScope(*commandBuffer);
+			s_Stats.DrawCalls = s_Data.GpuGroups.size() * (prepass ? 2 : 1);
+
+			// The late phase tests what the early one rejected against the depth just drawn, so objects that became visible
+			// are drawn in this frame instead of the next one. The pyramid is kept as the previous depth of the next frame:
+			// it misses the late draws, which only makes the next early phase more conservative
+			if (s_Config.OcclusionCulling)
+			{
+				GpuProfiler::BeginScope(*commandBuffer, "Hi-Z");
+				BuildDepthPyramid(*commandBuffer);
+				GpuProfiler::EndScope(*commandBuffer);
+
+				GpuProfiler::BeginScope(*commandBuffer, "Occlusion cull");
+				CullOnGpu(*commandBuffer, true);
+				GpuProfiler::EndScope(*commandBuffer);
+
+				GpuProfiler::BeginScope(*commandBuffer, "Geometry pass (late)");
+				DrawGpuGeometry(*commandBuffer, s_Data.GeometryLatePass, prepass, geometryPipeline);
+				GpuProfiler::EndScope(*commandBuffer);
+				s_Stats.DrawCalls *= 2;
+			}
+			EndStatistics(*commandBuffer, frame);
+
+			s_Stats.RecordingTime = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - recordStart).count();
+		}
+		else
+		{
+			// Timestamps can't be written inside a subpass recorded from secondary buffers
+			GpuProfiler::BeginScope(*commandBuffer, "Geometry pass");
+			BeginStatistics(*commandBuffer, frame);
+			s_Data.GeometryPass->Begin(*s_Data.GBuffers[frame], geometryPipeline, s_Data.Extent, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+
+			// At most one slice of the draw list per thread, so that each slice maps to a pool and a secondary buffer
+			uint32_t drawCount = s_Data.InstancedDraws.size();
+			uint32_t threadCount = ThreadPool::ThreadCount();
+			uint32_t minChunkSize = std::max((drawCount + threadCount - 1) / threadCount, s_MinDrawsPerThread);
+			uint32_t chunkCount = ThreadPool::ChunkCount(drawCount, minChunkSize);
+
+			auto recordStart = std::chrono::high_resolution_clock::now();
+			ThreadPool::ParallelFor(drawCount, minChunkSize, [&](uint32_t chunk, uint32_t begin, uint32_t end)
+			{
+				// Resetting the whole pool is cheaper than resetting its buffers one by one
+				s_Data.RecordingPools[frame][chunk]->Reset();
+				if (prepass)
+					RecordDraws(*s_Data.PrepassBuffers[frame][chunk], s_Data.DepthPrepassPipeline, begin, end);
+				RecordDraws(*s_Data.SecondaryBuffers[frame][chunk], geometryPipeline, begin, end);
+			});
+			s_Stats.RecordingTime = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - recordStart).count();
+			if (prepass)
+				s_Stats.DrawCalls *= 2;
+
+			// The whole depth has to be written before the first shaded draw, so all the prepass buffers go first
+			std::vector<VkCommandBuffer> secondaries;
+			if (prepass)
+				for (uint32_t i = 0; i < chunkCount; i++)
+					secondaries.push_back(*s_Data.PrepassBuffers[frame][i]);
+			for (uint32_t i = 0; i < chunkCount; i++)
+				secondaries.push_back(*s_Data.SecondaryBuffers[frame][i]);
+
+			if (!secondaries.empty())
+				vkCmdExecuteCommands(*commandBuffer, secondaries.size(), secondaries.data());
+			s_Data.GeometryPass->End();
+			EndStatistics(*commandBuffer, frame);
+			GpuProfiler::EndScope(*commandBuffer);
+		}
+
+		TransitionGBuffer(*commandBuffer);
+		GpuProfiler::BeginScope(*commandBuffer, "Lighting pass");
+		DrawLighting(*commandBuffer);
+		GpuProfiler::EndScope(*commandBuffer);
+
+		if (!s_Data.Readbacks.empty())
+		{
+			GpuProfiler::BeginScope(*commandBuffer, "Readback");
+			CopyToReadback(*commandBuffer);
+			GpuProfiler::EndScope(*commandBuffer);
+		}
+		GpuProfiler::EndScope(*commandBuffer);
+		commandBuffer->End();
+
+		uint64_t value = VulkanCore::GraphicsQueue()->Submit({ commandBuffer }, !s_Config.Headless, transferValue);
+		s_Data.FrameValues[State::CurrentFramebufferIndex()] = value;
+
+		if (s_Config.Headless)
+		{
+			s_Data.LastReadback = State::CurrentFramebufferIndex();
+			s_Data.LastReadbackValue = value;
+			State::SetCurrentFrameIndex((State::CurrentFramebufferIndex() + 1) % s_Config.MaxFramesInFlight);
+			return;
+		}
+
+		VkResult res = VulkanCore::PresentQueue()->Present(s_Data.Swapchain);
+
+		State::SetCurrentFrameIndex((State::CurrentFramebufferIndex() + 1) % s_Config.MaxFramesInFlight);
+
+		if (res == VK_ERROR_OUT_OF_DATE_KHR || res == VK_SUBOPTIMAL_KHR)
+			ResizeScreen();
+	}
+
+	bool Renderer::ReadPixels(std::vector<uint8_t>& pixels)
+	{
+		if (s_Data.Readbacks.empty() || s_Data.LastReadback < 0)
+			return false;
+		if (s_Config.RenderThread)
+		{
+			std::cerr << "ReadPixels isn't available with the render thread" << std::endl;
+			return false;
+		}
+
+		// The copy is recorded at the end of the last frame
+		Synchronization::FrameTimeline()->Wait(s_Data.LastReadbackValue);
+
+		Ref<Buffer> readback = s_Data.Readbacks[s_Data.LastReadback];
+		pixels.resize(readback->Size());
+		memcpy(pixels.data(), readback->Mapped(), readback->Size());
+
+		return true;
+	}
 
 	void Renderer::Destroy()
 	{
+		// Draw what has already been submitted, then stop the render thread
+		if (s_RenderThread.Thread.joinable())
+		{
+			s_RenderThread.Submitted.Close();
+			s_RenderThread.Free.Close();
+			s_RenderThread.Thread.join();
+		}
+
 		Debug::Shutdown();
 		
 		vkDeviceWaitIdle(VulkanCore::Device());
+		s_Registry.Clear();
+		s_Handles.Clear();
+		for (auto& packet : s_RenderThread.Packets)
+			packet.Clear();
+
+		s_Data.SecondaryBuffers.clear();
+		s_Data.PrepassBuffers.clear();
+		s_Data.RecordingPools.clear();
+		s_Data.GpuFrames.clear();
+		s_Data.GpuLods = nullptr;
+		s_Data.GpuLodCapacity = 0;
+		s_Data.FrameAllocators.clear();
+		s_Data.Readbacks.clear();
+		s_Data.GBuffers.clear();
+		s_Data.LightFrames.clear();
+		s_Data.ClusterPipeline = nullptr;
+		s_Data.Objects = {};
+		s_Data.CullPipeline = nullptr;
+		s_Data.Pyramid = nullptr;
+		s_Data.GeometryLatePass = nullptr;
+		TransferCommands::Shutdown();
+		ImmediateCommands::Shutdown();
+		StagingRing::Shutdown();
+		Synchronization::Shutdown();
+		ThreadPool::Shutdown();
 		
+		GpuProfiler::Shutdown();
+		if (s_Data.StatisticsPool != VK_NULL_HANDLE)
+			vkDestroyQueryPool(VulkanCore::Device(), s_Data.StatisticsPool, nullptr);
+		vkDestroySampler(VulkanCore::Device(), s_Data.GBufferSampler, nullptr);
 		vkDestroyDescriptorPool(VulkanCore::Device(), s_Data.DescriptorPool, nullptr);
 		vkDestroyDescriptorSetLayout(VulkanCore::Device(), s_Data.DescriptorSetLayout, nullptr);
+		vkDestroyDescriptorSetLayout(VulkanCore::Device(), s_Data.LightingDescriptorSetLayout, nullptr);
+		vkDestroyDescriptorSetLayout(VulkanCore::Device(), s_Data.ClusterDescriptorSetLayout, nullptr);
+		if (s_Config.GpuDriven)
+			vkDestroyDescriptorSetLayout(VulkanCore::Device(), s_Data.CullDescriptorSetLayout, nullptr);
 
 		delete s_Data.Resources;
 	}
@@ -36,6 +36,8 @@
 			subset of stuff changes over time, and even in that case, it's probably just the material / uniforms
 */
 
+#include <Rendering/FramePacket.h>
+
 struct GLFWwindow;
 
 namespace Low
@@ -52,13 +54,75 @@ namespace Low
 		uint32_t ExtensionCount;
 
 		uint32_t MaxFramesInFlight;
+
+		// Culls and generates the draws on the GPU with a compute pass, falls back to the CPU path if the device doesn't
+		// support vkCmdDrawIndexedIndirectCount
+		bool GpuDriven = false;
+
+		// Renders without render pass and framebuffer objects: attachments are image views picked when the passes are
+		// recorded, and pipelines only know their formats. Falls back to render pass objects on devices without Vulkan 1.3
+		bool DynamicRendering = true;
+
+		// Initial size of the per-frame allocator transient data comes from, it grows if a frame needs more
+		uint32_t FrameArenaSize = 4 * 1024 * 1024;
+		// Size of the ring all uploads are staged in. Uploads wait for older ones when it's full, bigger ones get their own buffer
+		uint32_t StagingRingSize = 32 * 1024 * 1024;
+
+		// Draws on a dedicated thread: End hands the frame packet over and returns, so the application builds the next frame
+		// while the current one is recorded and submitted. Resources (meshes, textures) and upload batches have to be created
+		// before the first End, since their uploads share the graphics queue with the render thread, unless the device has a
+		// transfer only queue: uploads and batches go there and the frames acquire them, so meshes and textures can be
+		// streamed in
+		bool RenderThread = false;
+
+		// Renders into a ring of offscreen color targets, one per frame in flight, instead of a swapchain. No window is
+		// needed: Init takes a nullptr window handle
+		bool Headless = false;
+		uint32_t HeadlessWidth = 1280;
+		uint32_t HeadlessHeight = 720;
+		// Copies every headless frame to host memory, so that it can be read with ReadPixels
+		bool HeadlessReadback = false;
+
+		// Draws the depth of the scene with a position only pipeline before filling the G-buffer, which then only shades the
+		// visible fragments. Pays off with heavy overdraw, can be changed per scene with SetDepthPrepass
+		bool DepthPrepass = false;
+
+		// Two phase Hi-Z occlusion culling, GPU driven path only. Objects hidden behind the depth of the previous frame are
+		// skipped, those that turn out visible are tested again against the depth of the current frame and drawn in a second pass
+		bool OcclusionCulling = false;
+
+		// Levels of detail are selected from the fraction of the screen height covered by the bounds of a renderable: the
+		// full mesh is drawn above LodThreshold, every next level once the coverage halves again. A level only changes once
+		// the coverage moves LodHysteresis (relative) past a threshold
+		float LodThreshold = 0.25f;
+		float LodHysteresis = 0.1f;
 	};
 
-	struct Renderable
+	struct RendererStats
 	{
-		Ref<Mesh> Mesh;
-		Ref<MaterialInstance> Material;
-		glm::mat4 Transform;
+		uint32_t VisibleRenderables = 0;
+		uint32_t CulledRenderables = 0;
+		// Visible renderables sharing mesh and material are merged into a single instanced draw
+		uint32_t DrawCalls = 0;
+		// Triangles of the selected levels of detail, CPU path only: the GPU driven path never reads its draws back
+		uint64_t Triangles = 0;
+
+		// Milliseconds spent in the last frame
+		float CullingTime = 0.0f;
+		float SortingTime = 0.0f;
+		float RecordingTime = 0.0f;
+
+		// Milliseconds spent in each stage of the last frame: Optimize culls and sorts, PrepareResources waits for the frame
+		// in flight and uploads, DrawFrame records and submits
+		float OptimizeTime = 0.0f;
+		float PrepareTime = 0.0f;
+		float DrawTime = 0.0f;
+		// GPU execution time of the frame, measured with timestamps. Lags MaxFramesInFlight frames behind, 0 if the device
+		// can't write timestamps on the graphics queue
+		float GpuTime = 0.0f;
+		// Fragment shader invocations of the geometry pass, measured with a pipeline statistics query. Same latency as GpuTime,
+		// 0 if the device doesn't support the query
+		uint64_t FragmentInvocations = 0;
 	};
 
 	class Renderer
@@ -67,18 +131,46 @@ namespace Low
 		static void Init(RendererConfig config, GLFWwindow* windowHandle);
 
 		static void Begin(const Camera& camera);
+		// Immediate mode: the model is only drawn in the current frame
 		static void PushModel(Ref<Mesh> mesh, Ref<MaterialInstance> material, const glm::mat4& transform);
+		// Lights only last for the current frame too. Shading only evaluates the lights whose radius reaches the pixel
+		static void PushLight(const PointLight& light);
 		static void End();
 
+		// Applies from the next Begin on
+		static void SetDepthPrepass(bool enabled);
+
+		// Retained mode: the renderable is drawn every frame until it's removed
+		static RenderableHandle AddRenderable(Ref<Mesh> mesh, Ref<MaterialInstance> material, const glm::mat4& transform);
+		static void UpdateTransform(RenderableHandle handle, const glm::mat4& transform);
+		static void RemoveRenderable(RenderableHandle handle);
+
 		static void DrawFrame();
 		static void Destroy();
 
+		// Stats of the last frame that finished drawing
+		static RendererStats Stats();
+		// BGRA8 pixels of the last headless frame, requires HeadlessReadback. Waits for the GPU to finish the frame, and isn't
+		// available with the render thread, which could be writing the frame while it's read
+		static bool ReadPixels(std::vector<uint8_t>& pixels);
+
 	private:
+		static void RenderPacket(FramePacket& packet);
+		static void RenderLoop();
+
 		static void Optimize();
-		static void PrepareResources();
+		// False if the swapchain had to be recreated: there's no image to draw the frame to
+		static bool PrepareResources();
 
 	private:
 		static std::vector<Ref<CommandBuffer>> s_CommandBuffers;
-		static std::unordered_map<UUID, std::vector<Renderable>> s_Renderables;
+		// Owned by the thread drawing the frames
+		static RenderableRegistry s_Registry;
+		static RendererStats s_Stats;
+
+		// Owned by the application thread: handles are allocated when the commands are recorded, so that they can be
+		// returned right away
+		static RenderableHandleAllocator s_Handles;
+		static FramePacket* s_Packet;
 	};
 }
\ No newline at end of file
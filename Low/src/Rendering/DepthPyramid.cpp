@@ -0,0 +1,238 @@
+#include <Rendering/DepthPyramid.h>
+
+#include <Vulkan/VulkanCore.h>
+#include <Vulkan/ComputePipeline.h>
+#include <Vulkan/Descriptor/DescriptorSetLayout.h>
+#include <Vulkan/Descriptor/DescriptorPool.h>
+#include <Vulkan/Command/ImmediateCommands.h>
+
+#include <Hardware/Memory.h>
+#include <Resources/Shader.h>
+
+namespace Low
+{
+	static const uint32_t s_ReduceGroupSize = 8;
+
+	// Layout shared with hiz.comp
+	struct ReducePushConstants
+	{
+		glm::ivec2 SourceSize;
+		glm::ivec2 DestinationSize;
+	};
+
+	static glm::ivec2 LevelSize(uint32_t width, uint32_t height, uint32_t level)
+	{
+		return glm::ivec2(std::max(width >> level, 1u), std::max(height >> level, 1u));
+	}
+
+	DepthPyramid::DepthPyramid(uint32_t width, uint32_t height, uint32_t sourceCount) : m_Width(width), m_Height(height)
+	{
+		DescriptorSetLayout setLayout({
+			DescriptorSetBinding(DescriptorSetType::Sampler, ShaderStage::Compute, 0, 1),
+			DescriptorSetBinding(DescriptorSetType::StorageImage, ShaderStage::Compute, 1, 1)
+		});
+		m_SetLayout = setLayout;
+		m_Pipeline = CreateRef<ComputePipeline>(CreateRef<Shader>("hiz", ShaderStage::Compute), setLayout, sizeof(ReducePushConstants));
+
+		// Depths are read with texelFetch, the sampler is only there because the descriptors need one
+		VkSamplerCreateInfo samplerInfo = {};
+		samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+		samplerInfo.magFilter = VK_FILTER_NEAREST;
+		samplerInfo.minFilter = VK_FILTER_NEAREST;
+		samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+		samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+		samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+		samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+		samplerInfo.maxLod = VK_LOD_CLAMP_NONE;
+
+		if (vkCreateSampler(VulkanCore::Device(), &samplerInfo, nullptr, &m_Sampler) != VK_SUCCESS)
+			throw std::runtime_error("Couldn't create depth pyramid sampler");
+
+		std::vector<VkDescriptorSetLayout> layouts(MaxLevels, m_SetLayout);
+		VkDescriptorSetAllocateInfo allocateInfo = {};
+		allocateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+		allocateInfo.descriptorPool = *VulkanCore::DescriptorPool();
+		allocateInfo.descriptorSetCount = MaxLevels;
+		allocateInfo.pSetLayouts = layouts.data();
+
+		m_Sets.resize(sourceCount);
+		for (auto& sets : m_Sets)
+			if (vkAllocateDescriptorSets(VulkanCore::Device(), &allocateInfo, sets.data()) != VK_SUCCESS)
+				throw std::runtime_error("Couldn't allocate depth pyramid descriptor sets");
+
+		CreateImage();
+	}
+
+	DepthPyramid::~DepthPyramid()
+	{
+		DestroyImage();
+		m_Pipeline = nullptr;
+		vkDestroySampler(VulkanCore::Device(), m_Sampler, nullptr);
+		vkDestroyDescriptorSetLayout(VulkanCore::Device(), m_SetLayout, nullptr);
+	}
+
+	void DepthPyramid::Resize(uint32_t width, uint32_t height)
+	{
+		DestroyImage();
+		m_Width = width;
+		m_Height = height;
+		CreateImage();
+	}
+
+	void DepthPyramid::CreateImage()
+	{
+		m_Levels = std::min((uint32_t)std::floor(std::log2(std::max(m_Width, m_Height))) + 1, MaxLevels);
+		m_Valid = false;
+
+		VkImageCreateInfo imageInfo = {};
+		imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+		imageInfo.imageType = VK_IMAGE_TYPE_2D;
+		imageInfo.extent = { m_Width, m_Height, 1 };
+		imageInfo.mipLevels = m_Levels;
+		imageInfo.arrayLayers = 1;
+		imageInfo.format = VK_FORMAT_R32_SFLOAT;
+		imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+		imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+		imageInfo.usage = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_STORAGE_BIT;
+		imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+		imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+
+		if (vkCreateImage(VulkanCore::Device(), &imageInfo, nullptr, &m_Image) != VK_SUCCESS)
+			throw std::runtime_error("Couldn't create depth pyramid");
+
+		m_Memory = Memory::AllocateImage(m_Image);
+
+		VkImageViewCreateInfo viewInfo = {};
+		viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+		viewInfo.image = m_Image;
+		viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+		viewInfo.format = VK_FORMAT_R32_SFLOAT;
+		viewInfo.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, m_Levels, 0, 1 };
+
+		if (vkCreateImageView(VulkanCore::Device(), &viewInfo, nullptr, &m_View) != VK_SUCCESS)
+			throw std::runtime_error("Couldn't create depth pyramid view");
+
+		m_LevelViews.resize(m_Levels);
+		for (uint32_t i = 0; i < m_Levels; i++)
+		{
+			viewInfo.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, i, 1, 0, 1 };
+			if (vkCreateImageView(VulkanCore::Device(), &viewInfo, nullptr, &m_LevelViews[i]) != VK_SUCCESS)
+				throw std::runtime_error("Couldn't create depth pyramid level view");
+		}
+
+		// Never leaves GENERAL: levels are written as storage images and read back by the next level and the culling pass
+		VkCommandBuffer commandBuffer = ImmediateCommands::Begin();
+		VkImageMemoryBarrier barrier = {};
+		barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+		barrier.srcAccessMask = 0;
+		barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+		barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+		barrier.newLayout = VK_IMAGE_LAYOUT_GENERAL;
+		barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.image = m_Image;
+		barrier.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, m_Levels, 0, 1 };
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+		ImmediateCommands::End(commandBuffer);
+
+		for (uint32_t i = 0; i < m_Sets.size(); i++)
+			WriteLevelDescriptors(i);
+	}
+
+	void DepthPyramid::DestroyImage()
+	{
+		for (auto view : m_LevelViews)
+			vkDestroyImageView(VulkanCore::Device(), view, nullptr);
+		m_LevelViews.clear();
+
+		vkDestroyImageView(VulkanCore::Device(), m_View, nullptr);
+		vkDestroyImage(VulkanCore::Device(), m_Image, nullptr);
+		Memory::Free(m_Memory);
+	}
+
+	void DepthPyramid::WriteLevelDescriptors(uint32_t source)
+	{
+		// Level 0 reads the depth given to SetSource, the others read the level above them
+		std::vector<VkDescriptorImageInfo> imageInfos(m_Levels * 2);
+		std::vector<VkWriteDescriptorSet> descriptorWrites(m_Levels * 2);
+		for (uint32_t i = 0; i < m_Levels; i++)
+		{
+			// Until the source is set, level 0 reads itself: never built like this, but the set has to be valid
+			VkDescriptorImageInfo& src = imageInfos[i * 2];
+			src.sampler = m_Sampler;
+			src.imageView = i > 0 ? m_LevelViews[i - 1] : m_LevelViews[0];
+			src.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+
+			VkDescriptorImageInfo& dst = imageInfos[i * 2 + 1];
+			dst.imageView = m_LevelViews[i];
+			dst.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+
+			for (uint32_t b = 0; b < 2; b++)
+			{
+				VkWriteDescriptorSet& write = descriptorWrites[i * 2 + b];
+				write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+				write.dstSet = m_Sets[source][i];
+				write.dstBinding = b;
+				write.dstArrayElement = 0;
+				write.descriptorType = b == 0 ? VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER : VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+				write.descriptorCount = 1;
+				write.pImageInfo = &imageInfos[i * 2 + b];
+			}
+		}
+
+		vkUpdateDescriptorSets(VulkanCore::Device(), descriptorWrites.size(), descriptorWrites.data(), 0, nullptr);
+	}
+
+	void DepthPyramid::SetSource(uint32_t source, VkImageView depthView)
+	{
+		VkDescriptorImageInfo imageInfo = {};
+		imageInfo.sampler = m_Sampler;
+		imageInfo.imageView = depthView;
+		imageInfo.imageLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
+
+		VkWriteDescriptorSet descriptorWrite = {};
+		descriptorWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		descriptorWrite.dstSet = m_Sets[source][0];
+		descriptorWrite.dstBinding = 0;
+		descriptorWrite.dstArrayElement = 0;
+		descriptorWrite.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+		descriptorWrite.descriptorCount = 1;
+		descriptorWrite.pImageInfo = &imageInfo;
+
+		vkUpdateDescriptorSets(VulkanCore::Device(), 1, &descriptorWrite, 0, nullptr);
+	}
+
+	void DepthPyramid::Build(VkCommandBuffer commandBuffer, uint32_t source)
+	{
+		// The culling passes recorded before may still be reading the levels
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 0, nullptr, 0, nullptr, 0, nullptr);
+
+		m_Pipeline->Bind(commandBuffer);
+		for (uint32_t i = 0; i < m_Levels; i++)
+		{
+			ReducePushConstants consts;
+			consts.SourceSize = LevelSize(m_Width, m_Height, i > 0 ? i - 1 : 0);
+			consts.DestinationSize = LevelSize(m_Width, m_Height, i);
+
+			vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_Pipeline->Layout(), 0, 1, &m_Sets[source][i], 0, nullptr);
+			vkCmdPushConstants(commandBuffer, m_Pipeline->Layout(), VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(ReducePushConstants), &consts);
+			vkCmdDispatch(commandBuffer, (consts.DestinationSize.x + s_ReduceGroupSize - 1) / s_ReduceGroupSize,
+				(consts.DestinationSize.y + s_ReduceGroupSize - 1) / s_ReduceGroupSize, 1);
+
+			// The next level, or the culling pass for the last one, reads what was just written
+			VkImageMemoryBarrier barrier = {};
+			barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+			barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+			barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+			barrier.oldLayout = VK_IMAGE_LAYOUT_GENERAL;
+			barrier.newLayout = VK_IMAGE_LAYOUT_GENERAL;
+			barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+			barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+			barrier.image = m_Image;
+			barrier.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, i, 1, 0, 1 };
+			vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+		}
+
+		m_Valid = true;
+	}
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <Hardware/Memory.h>
+
+namespace Low
+{
+	class ComputePipeline;
+
+	// Hierarchical depth: level 0 is a copy of a depth attachment, every other level keeps the farthest depth of the texels it
+	// covers in the previous one. Odd sizes fold the last row and column into the last texel, so that texel x of level l
+	// always covers the pixels [x * 2^l, (x + 1) * 2^l) of the depth. Built in compute, always in VK_IMAGE_LAYOUT_GENERAL
+	class DepthPyramid
+	{
+	public:
+		static const uint32_t MaxLevels = 16;
+
+		// One source per frame in flight, given with SetSource
+		DepthPyramid(uint32_t width, uint32_t height, uint32_t sourceCount);
+		~DepthPyramid();
+
+		// The sources have to be set again afterwards
+		void Resize(uint32_t width, uint32_t height);
+		// The depth is sampled in VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL
+		void SetSource(uint32_t source, VkImageView depthView);
+
+		// Recorded outside render passes. The source must be readable by compute shaders, the pyramid is readable by compute
+		// shaders once the reduction is done
+		void Build(VkCommandBuffer commandBuffer, uint32_t source);
+
+		inline VkImageView View() { return m_View; }
+		inline VkSampler Sampler() { return m_Sampler; }
+		inline glm::vec2 Size() { return glm::vec2(m_Width, m_Height); }
+		inline uint32_t Levels() { return m_Levels; }
+		// False until the first build after a resize, the pyramid doesn't hold any depth before
+		inline bool Valid() { return m_Valid; }
+
+	private:
+		void CreateImage();
+		void DestroyImage();
+		void WriteLevelDescriptors(uint32_t source);
+
+	private:
+		uint32_t m_Width = 0;
+		uint32_t m_Height = 0;
+		uint32_t m_Levels = 0;
+		bool m_Valid = false;
+
+		VkImage m_Image = VK_NULL_HANDLE;
+		MemoryAllocation m_Memory;
+		// Whole chain, sampled by the culling pass
+		VkImageView m_View = VK_NULL_HANDLE;
+		std::vector<VkImageView> m_LevelViews;
+		VkSampler m_Sampler = VK_NULL_HANDLE;
+
+		Ref<ComputePipeline> m_Pipeline;
+		VkDescriptorSetLayout m_SetLayout;
+		// Per source and per level: reads the level above, or the depth for level 0, and writes the level
+		std::vector<std::array<VkDescriptorSet, MaxLevels>> m_Sets;
+	};
+}
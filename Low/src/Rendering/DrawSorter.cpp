@@ -0,0 +1,90 @@
+#include <Rendering/DrawSorter.h>
+
+#include <cassert>
+#include <cstring>
+
+namespace Low
+{
+	static constexpr uint32_t s_PipelineBits = 8;
+	static constexpr uint32_t s_MaterialBits = 14;
+	static constexpr uint32_t s_MeshBits = 14;
+	static constexpr uint32_t s_LodBits = 2;
+	static constexpr uint32_t s_DepthBits = 24;
+
+	static inline uint64_t QuantizeDepth(float viewDepth)
+	{
+		// The bit pattern of a positive float grows with its value, so its top bits are a monotonic, logarithmic
+		// quantization: more precision close to the camera, where it matters the most
+		float depth = std::max(viewDepth, 0.0f);
+		uint32_t bits;
+		memcpy(&bits, &depth, sizeof(float));
+
+		return bits >> (31 - s_DepthBits);
+	}
+
+	uint64_t DrawSorter::MakeKey(DrawPass pass, uint32_t pipeline, uint32_t material, uint32_t mesh, uint32_t lod, float viewDepth)
+	{
+		// Wider values would alias other draws and break the grouping by state
+		assert(pipeline < (1u << s_PipelineBits) && material < (1u << s_MaterialBits) && mesh < (1u << s_MeshBits) && lod < (1u << s_LodBits));
+
+		uint64_t state = ((uint64_t)(pipeline & ((1 << s_PipelineBits) - 1)) << (s_MaterialBits + s_MeshBits + s_LodBits)) |
+			((uint64_t)(material & ((1 << s_MaterialBits) - 1)) << (s_MeshBits + s_LodBits)) |
+			((uint64_t)(mesh & ((1 << s_MeshBits) - 1)) << s_LodBits) |
+			(uint64_t)(lod & ((1 << s_LodBits) - 1));
+		uint64_t depth = QuantizeDepth(viewDepth);
+		uint64_t key = (uint64_t)pass << 62;
+
+		if (pass == DrawPass::Opaque)
+			key |= (state << s_DepthBits) | depth;
+		else
+			key |= ((((1ull << s_DepthBits) - 1) - depth) << (s_PipelineBits + s_MaterialBits + s_MeshBits + s_LodBits)) | state;
+
+		return key;
+	}
+
+	void DrawSorter::Sort(std::vector<DrawItem>& items)
+	{
+		size_t count = items.size();
+		if (count < 2)
+			return;
+
+		m_Scratch.resize(count);
+
+		// Build the histograms of all the digits in a single pass
+		std::vector<uint32_t> histograms(8 * 256, 0);
+		for (auto& item : items)
+			for (uint32_t digit = 0; digit < 8; digit++)
+				histograms[digit * 256 + ((item.Key >> (digit * 8)) & 0xFF)]++;
+
+		DrawItem* src = items.data();
+		DrawItem* dst = m_Scratch.data();
+
+		for (uint32_t digit = 0; digit < 8; digit++)
+		{
+			uint32_t* histogram = &histograms[digit * 256];
+			uint32_t shift = digit * 8;
+
+			// Every key has the same value for this digit, so the pass wouldn't change the order. This skips most of the
+			// passes in practice, since the unused high bits of the ids are always zero
+			if (histogram[(src[0].Key >> shift) & 0xFF] == count)
+				continue;
+
+			uint32_t offsets[256];
+			uint32_t sum = 0;
+			for (uint32_t i = 0; i < 256; i++)
+			{
+				offsets[i] = sum;
+				sum += histogram[i];
+			}
+
+			for (size_t i = 0; i < count; i++)
+				dst[offsets[(src[i].Key >> shift) & 0xFF]++] = src[i];
+
+			std::swap(src, dst);
+		}
+
+		// An odd number of passes leaves the result in the scratch buffer
+		if (src != items.data())
+			memcpy(items.data(), src, count * sizeof(DrawItem));
+	}
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+/*
+*	Sort key layout, from the most significant bit:
+*
+*	Opaque:			| pass (2) | pipeline (8) | material (14) | mesh (14) | lod (2) | depth (24) |
+*	Transparent:	| pass (2) | inverted depth (24) | pipeline (8) | material (14) | mesh (14) | lod (2) |
+*
+*	Opaque draws are grouped by state first and then sorted front to back, so that state changes are minimized and early-Z
+*	can reject as many fragments as possible. Transparent draws must be blended back to front, so depth comes first.
+*/
+
+namespace Low
+{
+	enum class DrawPass : uint32_t { Opaque = 0, Transparent = 1 };
+
+	struct DrawItem
+	{
+		uint64_t Key;
+		uint32_t Batch;
+		uint32_t Index;
+	};
+
+	class DrawSorter
+	{
+	public:
+		static uint64_t MakeKey(DrawPass pass, uint32_t pipeline, uint32_t material, uint32_t mesh, uint32_t lod, float viewDepth);
+
+		// Sorts the items by key using an LSD radix sort on 8 bit digits
+		void Sort(std::vector<DrawItem>& items);
+
+	private:
+		std::vector<DrawItem> m_Scratch;
+	};
+}
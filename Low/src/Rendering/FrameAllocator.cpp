@@ -0,0 +1,64 @@
+#include <Rendering/FrameAllocator.h>
+
+#include <Vulkan/VulkanCore.h>
+#include <Structures/Buffer.h>
+
+namespace Low
+{
+	FrameAllocator::FrameAllocator(VkDeviceSize capacity)
+	{
+		VkPhysicalDeviceProperties properties;
+		vkGetPhysicalDeviceProperties(VulkanCore::PhysicalDevice(), &properties);
+
+		// Allocations can be bound as uniform or storage buffers: satisfy both
+		m_MinAlignment = std::max(properties.limits.minUniformBufferOffsetAlignment, properties.limits.minStorageBufferOffsetAlignment);
+		m_MinAlignment = std::max(m_MinAlignment, (VkDeviceSize)16);
+
+		CreateBlock(capacity);
+	}
+
+	FrameAllocation FrameAllocator::Allocate(VkDeviceSize size, VkDeviceSize alignment)
+	{
+		alignment = std::max(alignment, m_MinAlignment);
+		VkDeviceSize offset = (m_Offset + alignment - 1) / alignment * alignment;
+
+		// Out of space: keep the old block alive until the GPU is done with it and continue in a bigger one. Only happens
+		// until the capacity settles on the peak usage
+		if (offset + size > m_Capacity)
+		{
+			m_Retired.push_back(m_Block);
+			CreateBlock(std::max(m_Capacity * 2, size + alignment));
+			offset = 0;
+		}
+
+		m_Offset = offset + size;
+
+		FrameAllocation ret;
+		ret.Buffer = *m_Block;
+		ret.Offset = offset;
+		ret.Size = size;
+		ret.Data = m_Mapped + offset;
+
+		return ret;
+	}
+
+	void FrameAllocator::Reset()
+	{
+		m_Offset = 0;
+		m_Retired.clear();
+	}
+
+	VkBuffer FrameAllocator::CurrentBuffer() const
+	{
+		return *m_Block;
+	}
+
+	void FrameAllocator::CreateBlock(VkDeviceSize capacity)
+	{
+		m_Capacity = capacity;
+		m_Offset = 0;
+
+		m_Block = CreateRef<Low::Buffer>(capacity, BufferUsage::Transient);
+		m_Mapped = (uint8_t*)m_Block->Mapped();
+	}
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+namespace Low
+{
+	class Buffer;
+
+	struct FrameAllocation
+	{
+		VkBuffer Buffer = VK_NULL_HANDLE;
+		VkDeviceSize Offset = 0;
+		VkDeviceSize Size = 0;
+		// Persistently mapped and coherent: writing here is enough for the GPU to see the data
+		void* Data = nullptr;
+	};
+
+	// Linear allocator over a persistently mapped, host visible buffer, used for data that only lives for a frame.
+	// Each frame in flight owns one and resets it once its timeline value has been reached, so allocating is just a bump
+	class FrameAllocator
+	{
+	public:
+		FrameAllocator(VkDeviceSize capacity);
+
+		// Offsets are aligned to alignment and to the minimum uniform and storage buffer offset alignments of the device
+		FrameAllocation Allocate(VkDeviceSize size, VkDeviceSize alignment = 1);
+		// Only call when the GPU isn't using any of the allocations anymore
+		void Reset();
+
+		// The buffer allocations are currently made from. It only changes when the allocator runs out of space
+		VkBuffer CurrentBuffer() const;
+		inline VkDeviceSize Capacity() const { return m_Capacity; }
+		inline VkDeviceSize Used() const { return m_Offset; }
+
+	private:
+		void CreateBlock(VkDeviceSize capacity);
+
+	private:
+		Ref<Low::Buffer> m_Block;
+		uint8_t* m_Mapped = nullptr;
+
+		VkDeviceSize m_Capacity = 0;
+		VkDeviceSize m_Offset = 0;
+		VkDeviceSize m_MinAlignment = 1;
+
+		// Blocks that ran out of space during the frame: the GPU may still read them until the next reset
+		std::vector<Ref<Low::Buffer>> m_Retired;
+	};
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <Rendering/RenderableRegistry.h>
+#include <Rendering/Light.h>
+#include <Resources/Camera.h>
+
+namespace Low
+{
+	enum class RenderCommandType { Add = 0, UpdateTransform, Remove };
+
+	// A change to the renderables, recorded by the application and applied to the registry by the thread drawing the frame
+	struct RenderCommand
+	{
+		RenderCommandType Type;
+		RenderableHandle Handle;
+
+		// Add only
+		Ref<Low::Mesh> Mesh;
+		Ref<MaterialInstance> Material;
+		// Add and UpdateTransform
+		glm::mat4 Transform;
+	};
+
+	// Everything needed to draw a frame. Built by the application between Begin and End, then never touched again by it
+	// until the renderer hands it back, so the two threads never share scene data
+	struct FramePacket
+	{
+		Low::Camera Camera;
+		std::vector<RenderCommand> Commands;
+		// Immediate mode renderables: added with the commands and removed once the frame has been drawn
+		std::vector<RenderableHandle> Transients;
+		// Lights only live for the frame they were pushed in
+		std::vector<PointLight> Lights;
+		bool DepthPrepass = false;
+
+		// Keeps the capacity, so that packets stop allocating once they've been reused a few times
+		inline void Clear()
+		{
+			Commands.clear();
+			Transients.clear();
+			Lights.clear();
+		}
+	};
+}
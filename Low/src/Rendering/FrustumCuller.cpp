@@ -0,0 +1,141 @@
+#include <Rendering/FrustumCuller.h>
+#include <Core/ThreadPool.h>
+
+#if defined(__AVX__)
+	#define LOW_CULL_AVX
+	#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+	#define LOW_CULL_SSE
+	#include <emmintrin.h>
+#endif
+
+namespace Low
+{
+	// Below this amount of spheres per chunk, waking up the workers costs more than culling on a single thread
+	static const uint32_t s_MinChunkSize = 4096;
+
+	Frustum Frustum::FromViewProjection(const glm::mat4& viewProjection)
+	{
+		// Gribb-Hartmann: each plane is a sum or difference of the rows of the matrix. glm is column major, so a row is
+		// made of the i-th component of every column
+		glm::vec4 rows[4];
+		for (uint32_t i = 0; i < 4; i++)
+			rows[i] = glm::vec4(viewProjection[0][i], viewProjection[1][i], viewProjection[2][i], viewProjection[3][i]);
+
+		Frustum ret;
+		ret.Planes[0] = rows[3] + rows[0];	// Left
+		ret.Planes[1] = rows[3] - rows[0];	// Right
+		ret.Planes[2] = rows[3] + rows[1];	// Bottom
+		ret.Planes[3] = rows[3] - rows[1];	// Top
+		// With a [0, 1] depth range the near plane would be rows[2] alone: this one sits slightly behind it, which
+		// keeps culling conservative for both conventions
+		ret.Planes[4] = rows[3] + rows[2];	// Near
+		ret.Planes[5] = rows[3] - rows[2];	// Far
+
+		// Normalized planes give real distances, so that they can be compared against the radii
+		for (auto& plane : ret.Planes)
+			plane /= glm::length(glm::vec3(plane));
+
+		return ret;
+	}
+
+	static void CullScalar(const Frustum& frustum, const float* x, const float* y, const float* z, const float* radius,
+		uint32_t begin, uint32_t end, std::vector<uint32_t>& visible)
+	{
+		for (uint32_t i = begin; i < end; i++)
+		{
+			bool inside = true;
+			for (uint32_t p = 0; p < 6 && inside; p++)
+			{
+				const glm::vec4& plane = frustum.Planes[p];
+				inside = plane.x * x[i] + plane.y * y[i] + plane.z * z[i] + plane.w >= -radius[i];
+			}
+
+			if (inside)
+				visible.push_back(i);
+		}
+	}
+
+	static void CullRange(const Frustum& frustum, const float* x, const float* y, const float* z, const float* radius,
+		uint32_t begin, uint32_t end, std::vector<uint32_t>& visible)
+	{
+		uint32_t i = begin;
+
+#if defined(LOW_CULL_AVX)
+		__m256 planes[6][4];
+		for (uint32_t p = 0; p < 6; p++)
+			for (uint32_t c = 0; c < 4; c++)
+				planes[p][c] = _mm256_set1_ps(frustum.Planes[p][c]);
+
+		for (; i + 8 <= end; i += 8)
+		{
+			__m256 cx = _mm256_loadu_ps(x + i), cy = _mm256_loadu_ps(y + i), cz = _mm256_loadu_ps(z + i);
+			__m256 negRadius = _mm256_sub_ps(_mm256_setzero_ps(), _mm256_loadu_ps(radius + i));
+			__m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+
+			for (uint32_t p = 0; p < 6; p++)
+			{
+				__m256 distance = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(planes[p][0], cx), _mm256_mul_ps(planes[p][1], cy)),
+					_mm256_add_ps(_mm256_mul_ps(planes[p][2], cz), planes[p][3]));
+				inside = _mm256_and_ps(inside, _mm256_cmp_ps(distance, negRadius, _CMP_GE_OQ));
+			}
+
+			uint32_t mask = _mm256_movemask_ps(inside);
+			for (uint32_t bit = 0; bit < 8; bit++)
+				if (mask & (1u << bit))
+					visible.push_back(i + bit);
+		}
+#elif defined(LOW_CULL_SSE)
+		__m128 planes[6][4];
+		for (uint32_t p = 0; p < 6; p++)
+			for (uint32_t c = 0; c < 4; c++)
+				planes[p][c] = _mm_set1_ps(frustum.Planes[p][c]);
+
+		for (; i + 4 <= end; i += 4)
+		{
+			__m128 cx = _mm_loadu_ps(x + i), cy = _mm_loadu_ps(y + i), cz = _mm_loadu_ps(z + i);
+			__m128 negRadius = _mm_sub_ps(_mm_setzero_ps(), _mm_loadu_ps(radius + i));
+			__m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+
+			for (uint32_t p = 0; p < 6; p++)
+			{
+				__m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(planes[p][0], cx), _mm_mul_ps(planes[p][1], cy)),
+					_mm_add_ps(_mm_mul_ps(planes[p][2], cz), planes[p][3]));
+				inside = _mm_and_ps(inside, _mm_cmpge_ps(distance, negRadius));
+			}
+
+			uint32_t mask = _mm_movemask_ps(inside);
+			for (uint32_t bit = 0; bit < 4; bit++)
+				if (mask & (1u << bit))
+					visible.push_back(i + bit);
+		}
+#endif
+
+		// Remainder that doesn't fill a whole register, or everything when SIMD isn't available
+		CullScalar(frustum, x, y, z, radius, i, end, visible);
+	}
+
+	void FrustumCuller::Cull(const Frustum& frustum, const float* x, const float* y, const float* z, const float* radius, uint32_t count,
+		std::vector<uint32_t>& visible)
+	{
+		uint32_t chunkCount = ThreadPool::ChunkCount(count, s_MinChunkSize);
+		if (chunkCount <= 1)
+		{
+			CullRange(frustum, x, y, z, radius, 0, count, visible);
+			return;
+		}
+
+		// Each chunk writes to its own list, then the lists are joined in order so that the result stays sorted
+		if (m_ChunkResults.size() < chunkCount)
+			m_ChunkResults.resize(chunkCount);
+
+		ThreadPool::ParallelFor(count, s_MinChunkSize, [&](uint32_t chunk, uint32_t begin, uint32_t end)
+		{
+			m_ChunkResults[chunk].clear();
+			CullRange(frustum, x, y, z, radius, begin, end, m_ChunkResults[chunk]);
+		});
+
+		for (uint32_t i = 0; i < chunkCount; i++)
+			visible.insert(visible.end(), m_ChunkResults[i].begin(), m_ChunkResults[i].end());
+	}
+}
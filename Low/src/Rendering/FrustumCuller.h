@@ -0,0 +1,25 @@
+#pragma once
+
+namespace Low
+{
+	struct Frustum
+	{
+		// xyz is the normal, pointing inside the frustum, w the distance: a point p is inside if dot(xyz, p) + w >= 0
+		glm::vec4 Planes[6];
+
+		static Frustum FromViewProjection(const glm::mat4& viewProjection);
+	};
+
+	class FrustumCuller
+	{
+	public:
+		// Appends to visible the indices, in increasing order, of the spheres that intersect the frustum. Spheres are
+		// stored as separate arrays of components so that they can be tested 4 (SSE) or 8 (AVX) at a time. Large
+		// counts are split across the ThreadPool
+		void Cull(const Frustum& frustum, const float* x, const float* y, const float* z, const float* radius, uint32_t count,
+			std::vector<uint32_t>& visible);
+
+	private:
+		std::vector<std::vector<uint32_t>> m_ChunkResults;
+	};
+}
@@ -0,0 +1,24 @@
+#pragma once
+
+namespace Low
+{
+	struct PointLight
+	{
+		glm::vec3 Position;
+		glm::vec3 Color;
+		// The light doesn't reach further than this, which is what lets it be binned into clusters
+		float Radius;
+	};
+
+	// Lights are binned into a grid of screen tiles and exponential depth slices, the lighting pass only evaluates the lights
+	// of the cluster a pixel falls in. Shared with cluster.comp and lighting.frag
+	struct ClusterGrid
+	{
+		static const uint32_t TilesX = 16;
+		static const uint32_t TilesY = 9;
+		static const uint32_t Slices = 24;
+		static const uint32_t MaxLightsPerCluster = 128;
+
+		static const uint32_t Count = TilesX * TilesY * Slices;
+	};
+}
@@ -0,0 +1,254 @@
+#include <Rendering/RenderableRegistry.h>
+#include <Resources/MaterialInstance.h>
+#include <Resources/Mesh.h>
+
+namespace Low
+{
+	RenderableHandle RenderableHandleAllocator::Allocate()
+	{
+		// Reuse a dead slot if possible, the generation keeps stale handles from aliasing the new renderable
+		uint32_t index;
+		if (!m_FreeSlots.empty())
+		{
+			index = m_FreeSlots.back();
+			m_FreeSlots.pop_back();
+		}
+		else
+		{
+			index = m_Generations.size();
+			m_Generations.push_back(0);
+			m_Alive.push_back(false);
+		}
+
+		m_Alive[index] = true;
+		return { index, m_Generations[index] };
+	}
+
+	bool RenderableHandleAllocator::Free(RenderableHandle handle)
+	{
+		if (handle.Index >= m_Generations.size() || !m_Alive[handle.Index] || m_Generations[handle.Index] != handle.Generation)
+			return false;
+
+		m_Alive[handle.Index] = false;
+		m_Generations[handle.Index]++;
+		m_FreeSlots.push_back(handle.Index);
+		return true;
+	}
+
+	void RenderableHandleAllocator::Clear()
+	{
+		for (uint32_t i = 0; i < m_Generations.size(); i++)
+		{
+			if (!m_Alive[i])
+				continue;
+
+			m_Alive[i] = false;
+			m_Generations[i]++;
+			m_FreeSlots.push_back(i);
+		}
+	}
+
+	void RenderableRegistry::Add(RenderableHandle handle, Ref<Mesh> mesh, Ref<MaterialInstance> material, const glm::mat4& transform)
+	{
+		if (handle.Index >= m_Slots.size())
+			m_Slots.resize(handle.Index + 1);
+		else if (m_Slots[handle.Index].Alive)
+		{
+			std::cerr << "Renderable handle " << handle.Index << " is already in use" << std::endl;
+			return;
+		}
+
+		// Find the batch of the material, create it the first time the material is seen
+		UUID materialID = material->ID();
+		auto batchIt = m_BatchIndices.find(materialID);
+		uint32_t batchIndex;
+
+		if (batchIt == m_BatchIndices.end())
+		{
+			batchIndex = m_Batches.size();
+			m_BatchIndices[materialID] = batchIndex;
+
+			m_Batches.emplace_back();
+			m_Batches.back().Material = material;
+		}
+		else
+			batchIndex = batchIt->second;
+
+		uint32_t meshID = AcquireMeshID(mesh.get());
+
+		RenderableBatch& batch = m_Batches[batchIndex];
+		Slot& slot = m_Slots[handle.Index];
+		slot.Batch = batchIndex;
+		slot.Index = batch.Size();
+		slot.Generation = handle.Generation;
+		slot.Alive = true;
+
+		batch.Meshes.push_back(mesh);
+		batch.MeshIDs.push_back(meshID);
+		batch.Transforms.push_back(transform);
+		batch.BoundsX.push_back(0.0f);
+		batch.BoundsY.push_back(0.0f);
+		batch.BoundsZ.push_back(0.0f);
+		batch.BoundsRadius.push_back(0.0f);
+		batch.Lods.push_back(0);
+		batch.Owners.push_back(handle.Index);
+		UpdateBounds(batch, slot.Index);
+		MarkDirty(handle.Index);
+		m_Count++;
+	}
+
+	void RenderableRegistry::UpdateTransform(RenderableHandle handle, const glm::mat4& transform)
+	{
+		if (!IsValid(handle))
+			return;
+
+		const Slot& slot = m_Slots[handle.Index];
+		m_Batches[slot.Batch].Transforms[slot.Index] = transform;
+		UpdateBounds(m_Batches[slot.Batch], slot.Index);
+		MarkDirty(handle.Index);
+	}
+
+	void RenderableRegistry::Remove(RenderableHandle handle)
+	{
+		if (!IsValid(handle))
+			return;
+
+		Slot& slot = m_Slots[handle.Index];
+		RenderableBatch& batch = m_Batches[slot.Batch];
+		uint32_t last = batch.Size() - 1;
+		ReleaseMeshID(batch.Meshes[slot.Index].get());
+
+		// Swap with the last element to keep the batch dense, then fix the handle of the moved element
+		if (slot.Index != last)
+		{
+			batch.Meshes[slot.Index] = std::move(batch.Meshes[last]);
+			batch.MeshIDs[slot.Index] = batch.MeshIDs[last];
+			batch.Transforms[slot.Index] = batch.Transforms[last];
+			batch.BoundsX[slot.Index] = batch.BoundsX[last];
+			batch.BoundsY[slot.Index] = batch.BoundsY[last];
+			batch.BoundsZ[slot.Index] = batch.BoundsZ[last];
+			batch.BoundsRadius[slot.Index] = batch.BoundsRadius[last];
+			batch.Lods[slot.Index] = batch.Lods[last];
+			batch.Owners[slot.Index] = batch.Owners[last];
+
+			m_Slots[batch.Owners[slot.Index]].Index = slot.Index;
+		}
+
+		batch.Meshes.pop_back();
+		batch.MeshIDs.pop_back();
+		batch.Transforms.pop_back();
+		batch.BoundsX.pop_back();
+		batch.BoundsY.pop_back();
+		batch.BoundsZ.pop_back();
+		batch.BoundsRadius.pop_back();
+		batch.Lods.pop_back();
+		batch.Owners.pop_back();
+
+		slot.Alive = false;
+		m_Count--;
+	}
+
+	void RenderableRegistry::Clear()
+	{
+		for (auto& slot : m_Slots)
+		{
+			slot.Alive = false;
+			slot.Dirty = false;
+		}
+		m_DirtySlots.clear();
+
+		for (auto& batch : m_Batches)
+		{
+			batch.Meshes.clear();
+			batch.MeshIDs.clear();
+			batch.Transforms.clear();
+			batch.BoundsX.clear();
+			batch.BoundsY.clear();
+			batch.BoundsZ.clear();
+			batch.BoundsRadius.clear();
+			batch.Lods.clear();
+			batch.Owners.clear();
+		}
+		m_Count = 0;
+
+		m_MeshIDs.clear();
+		m_FreeMeshIDs.clear();
+		m_NextMeshID = 0;
+	}
+
+	bool RenderableRegistry::IsValid(RenderableHandle handle) const
+	{
+		return handle.Index < m_Slots.size() && m_Slots[handle.Index].Alive && m_Slots[handle.Index].Generation == handle.Generation;
+	}
+
+	const glm::mat4* RenderableRegistry::Transform(uint32_t slot) const
+	{
+		if (slot >= m_Slots.size() || !m_Slots[slot].Alive)
+			return nullptr;
+		return &m_Batches[m_Slots[slot].Batch].Transforms[m_Slots[slot].Index];
+	}
+
+	void RenderableRegistry::ClearDirty()
+	{
+		for (uint32_t slot : m_DirtySlots)
+			m_Slots[slot].Dirty = false;
+		m_DirtySlots.clear();
+	}
+
+	void RenderableRegistry::MarkDirty(uint32_t slot)
+	{
+		if (m_Slots[slot].Dirty)
+			return;
+
+		m_Slots[slot].Dirty = true;
+		m_DirtySlots.push_back(slot);
+	}
+
+	uint32_t RenderableRegistry::AcquireMeshID(Mesh* mesh)
+	{
+		auto it = m_MeshIDs.find(mesh);
+		if (it != m_MeshIDs.end())
+		{
+			it->second.Users++;
+			return it->second.ID;
+		}
+
+		uint32_t id;
+		if (!m_FreeMeshIDs.empty())
+		{
+			id = m_FreeMeshIDs.back();
+			m_FreeMeshIDs.pop_back();
+		}
+		else
+			id = m_NextMeshID++;
+
+		m_MeshIDs[mesh] = { id, 1 };
+		return id;
+	}
+
+	void RenderableRegistry::ReleaseMeshID(Mesh* mesh)
+	{
+		auto it = m_MeshIDs.find(mesh);
+		if (it == m_MeshIDs.end() || --it->second.Users > 0)
+			return;
+
+		m_FreeMeshIDs.push_back(it->second.ID);
+		m_MeshIDs.erase(it);
+	}
+
+	void RenderableRegistry::UpdateBounds(RenderableBatch& batch, uint32_t index)
+	{
+		const glm::mat4& transform = batch.Transforms[index];
+		glm::vec4 sphere = batch.Meshes[index]->BoundingSphere();
+		glm::vec3 center = transform * glm::vec4(glm::vec3(sphere), 1.0f);
+
+		// Non uniform scales stretch the sphere along the largest axis
+		float scale = std::max(std::max(glm::length(glm::vec3(transform[0])), glm::length(glm::vec3(transform[1]))),
+			glm::length(glm::vec3(transform[2])));
+
+		batch.BoundsX[index] = center.x;
+		batch.BoundsY[index] = center.y;
+		batch.BoundsZ[index] = center.z;
+		batch.BoundsRadius[index] = sphere.w * scale;
+	}
+}
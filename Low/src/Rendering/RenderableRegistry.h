@@ -0,0 +1,111 @@
+#pragma once
+
+namespace Low
+{
+	class Mesh;
+	class MaterialInstance;
+
+	struct RenderableHandle
+	{
+		uint32_t Index = UINT32_MAX;
+		uint32_t Generation = 0;
+
+		inline bool Valid() const { return Index != UINT32_MAX; }
+	};
+
+	// All the renderables sharing a material, stored as dense parallel arrays
+	struct RenderableBatch
+	{
+		Ref<MaterialInstance> Material;
+
+		std::vector<Ref<Mesh>> Meshes;
+		// Compact mesh identifiers, used to build sort keys
+		std::vector<uint32_t> MeshIDs;
+		std::vector<glm::mat4> Transforms;
+		// World space bounding spheres, split by component so that they can be culled 4 or 8 at a time
+		std::vector<float> BoundsX;
+		std::vector<float> BoundsY;
+		std::vector<float> BoundsZ;
+		std::vector<float> BoundsRadius;
+		// Level of detail drawn last time, so that the selection only changes once the coverage leaves the hysteresis band
+		std::vector<uint8_t> Lods;
+		// Handle slot owning each element, used to patch the handle table when elements are moved
+		std::vector<uint32_t> Owners;
+
+		inline uint32_t Size() const { return (uint32_t)Meshes.size(); }
+	};
+
+	// Hands out renderable handles. Kept apart from the registry, so that renderables can be created on a different thread than
+	// the one owning it
+	class RenderableHandleAllocator
+	{
+	public:
+		RenderableHandle Allocate();
+		// Returns false if the handle had already been freed
+		bool Free(RenderableHandle handle);
+		void Clear();
+
+	private:
+		std::vector<uint32_t> m_Generations;
+		std::vector<bool> m_Alive;
+		std::vector<uint32_t> m_FreeSlots;
+	};
+
+	class RenderableRegistry
+	{
+	public:
+		// The handle comes from a RenderableHandleAllocator and must not be in use
+		void Add(RenderableHandle handle, Ref<Mesh> mesh, Ref<MaterialInstance> material, const glm::mat4& transform);
+		void UpdateTransform(RenderableHandle handle, const glm::mat4& transform);
+		void Remove(RenderableHandle handle);
+		void Clear();
+
+		bool IsValid(RenderableHandle handle) const;
+
+		inline std::vector<RenderableBatch>& Batches() { return m_Batches; }
+		inline uint32_t Count() const { return m_Count; }
+		// Upper bound of the handle indices in use
+		inline uint32_t SlotCount() const { return (uint32_t)m_Slots.size(); }
+		// Transform of the renderable in a handle slot, nullptr if the slot isn't in use
+		const glm::mat4* Transform(uint32_t slot) const;
+
+		// Slots added or transformed since the last ClearDirty, each listed once
+		inline const std::vector<uint32_t>& DirtySlots() const { return m_DirtySlots; }
+		void ClearDirty();
+
+	private:
+		void UpdateBounds(RenderableBatch& batch, uint32_t index);
+		void MarkDirty(uint32_t slot);
+		uint32_t AcquireMeshID(Mesh* mesh);
+		void ReleaseMeshID(Mesh* mesh);
+
+	private:
+		struct Slot
+		{
+			uint32_t Batch;
+			uint32_t Index;
+			uint32_t Generation = 0;
+			bool Alive = false;
+			bool Dirty = false;
+		};
+
+		std::vector<RenderableBatch> m_Batches;
+		std::unordered_map<UUID, uint32_t> m_BatchIndices;
+		// Mesh identifiers and the amount of renderables using them. Identifiers of meshes that aren't used anymore are recycled,
+		// so that they stay small enough for the sort keys however many meshes are streamed in over time
+		struct MeshEntry
+		{
+			uint32_t ID;
+			uint32_t Users;
+		};
+		std::unordered_map<Mesh*, MeshEntry> m_MeshIDs;
+		std::vector<uint32_t> m_FreeMeshIDs;
+		uint32_t m_NextMeshID = 0;
+
+		// Indexed by handle index
+		std::vector<Slot> m_Slots;
+		std::vector<uint32_t> m_DirtySlots;
+
+		uint32_t m_Count = 0;
+	};
+}
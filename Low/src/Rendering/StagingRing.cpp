@@ -0,0 +1,177 @@
+#include <Rendering/StagingRing.h>
+
+#include <Vulkan/VulkanCore.h>
+#include <Structures/Buffer.h>
+#include <Synchronization/Synchronization.h>
+#include <Vulkan/Command/ImmediateCommands.h>
+
+namespace Low
+{
+	// Range of the ring, up to End, read by the submission signaling Value on Timeline. Bytes includes the padding skipped
+	// when wrapping
+	struct StagingRegion
+	{
+		VkDeviceSize End;
+		VkDeviceSize Bytes;
+		uint64_t Value;
+		Ref<Low::Timeline> Timeline;
+	};
+
+	struct StagingOverflow
+	{
+		Ref<Low::Buffer> Buffer;
+		uint64_t Value;
+		Ref<Low::Timeline> Timeline;
+	};
+
+	struct StagingState
+	{
+		Ref<Low::Buffer> Ring;
+		uint8_t* Mapped = nullptr;
+		VkDeviceSize Capacity = 0;
+		VkDeviceSize Alignment = 16;
+
+		// Allocations are made at Head, the oldest one still in use starts at Tail
+		VkDeviceSize Head = 0;
+		VkDeviceSize Tail = 0;
+		VkDeviceSize Used = 0;
+		std::deque<StagingRegion> Pending;
+
+		// Allocated since the last submission
+		VkDeviceSize BatchBytes = 0;
+		std::vector<Ref<Low::Buffer>> BatchOverflow;
+
+		std::deque<StagingOverflow> Overflow;
+		// The fallback is only reported the first time, streaming can hit it on every upload
+		bool OverflowReported = false;
+	} s_StagingState;
+
+	static void Reclaim()
+	{
+		StagingState& state = s_StagingState;
+
+		// In submission order, even across queues: a region is only reclaimed once the older ones are
+		while (!state.Pending.empty() && state.Pending.front().Timeline->IsComplete(state.Pending.front().Value))
+		{
+			state.Tail = state.Pending.front().End;
+			state.Used -= state.Pending.front().Bytes;
+			state.Pending.pop_front();
+		}
+		while (!state.Overflow.empty() && state.Overflow.front().Timeline->IsComplete(state.Overflow.front().Value))
+			state.Overflow.pop_front();
+
+		// Start over from the beginning when empty, so that big uploads don't have to wrap
+		if (state.Used == 0)
+			state.Head = state.Tail = 0;
+	}
+
+	// Returns false if there's no room, doesn't wait
+	static bool TryAllocate(VkDeviceSize size, VkDeviceSize& offset)
+	{
+		StagingState& state = s_StagingState;
+		VkDeviceSize aligned = (state.Head + state.Alignment - 1) / state.Alignment * state.Alignment;
+		bool wrapped = state.Head < state.Tail || (state.Head == state.Tail && state.Used > 0);
+
+		VkDeviceSize padding = 0;
+		if (!wrapped)
+		{
+			if (aligned + size <= state.Capacity)
+				offset = aligned;
+			else if (size <= state.Tail)
+			{
+				// Skip the end of the ring
+				offset = 0;
+				padding = state.Capacity - state.Head;
+			}
+			else
+				return false;
+		}
+		else if (aligned + size <= state.Tail)
+			offset = aligned;
+		else
+			return false;
+
+		if (offset != 0)
+			padding = offset - state.Head;
+
+		state.Head = offset + size;
+		state.Used += padding + size;
+		state.BatchBytes += padding + size;
+		return true;
+	}
+
+	void StagingRing::Init(VkDeviceSize capacity)
+	{
+		VkPhysicalDeviceProperties properties;
+		vkGetPhysicalDeviceProperties(VulkanCore::PhysicalDevice(), &properties);
+
+		// Copies to images need offsets aligned to the texel size, 16 covers all the formats used
+		s_StagingState.Alignment = std::max(properties.limits.optimalBufferCopyOffsetAlignment, (VkDeviceSize)16);
+		s_StagingState.Capacity = capacity;
+		s_StagingState.Ring = CreateRef<Low::Buffer>(capacity, BufferUsage::TransferSrc);
+		s_StagingState.Mapped = (uint8_t*)s_StagingState.Ring->Mapped();
+	}
+
+	void StagingRing::Shutdown()
+	{
+		s_StagingState = {};
+	}
+
+	StagingAllocation StagingRing::Allocate(VkDeviceSize size)
+	{
+		StagingState& state = s_StagingState;
+		StagingAllocation ret;
+
+		if (size <= state.Capacity)
+		{
+			VkDeviceSize offset;
+			Reclaim();
+			bool allocated = TryAllocate(size, offset);
+			while (!allocated)
+			{
+				// Unsubmitted allocations are only reclaimed once the batch reading them is submitted
+				if (state.Pending.empty() && state.BatchBytes > 0)
+					ImmediateCommands::Flush();
+				if (state.Pending.empty())
+					break;
+
+				state.Pending.front().Timeline->Wait(state.Pending.front().Value);
+				Reclaim();
+				allocated = TryAllocate(size, offset);
+			}
+
+			if (allocated)
+			{
+				ret.Buffer = *state.Ring;
+				ret.Offset = offset;
+				ret.Data = state.Mapped + offset;
+				return ret;
+			}
+		}
+
+		if (!state.OverflowReported)
+		{
+			std::cerr << "Staging ring too small, uploads that don't fit get temporary buffers. Consider increasing StagingRingSize" << std::endl;
+			state.OverflowReported = true;
+		}
+		Ref<Low::Buffer> buffer = CreateRef<Low::Buffer>(size, BufferUsage::TransferSrc);
+		state.BatchOverflow.push_back(buffer);
+
+		ret.Buffer = *buffer;
+		ret.Offset = 0;
+		ret.Data = buffer->Mapped();
+		return ret;
+	}
+
+	void StagingRing::Submitted(uint64_t value, Ref<Timeline> timeline)
+	{
+		StagingState& state = s_StagingState;
+		if (state.BatchBytes > 0)
+			state.Pending.push_back({ state.Head, state.BatchBytes, value, timeline });
+		for (auto& buffer : state.BatchOverflow)
+			state.Overflow.push_back({ buffer, value, timeline });
+
+		state.BatchBytes = 0;
+		state.BatchOverflow.clear();
+	}
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+namespace Low
+{
+	class Buffer;
+	class Timeline;
+
+	struct StagingAllocation
+	{
+		VkBuffer Buffer = VK_NULL_HANDLE;
+		VkDeviceSize Offset = 0;
+		// Persistently mapped and coherent
+		void* Data = nullptr;
+	};
+
+	// Single persistently mapped upload buffer shared by every upload: the data is copied in, then copied to its destination
+	// by a transfer command. Space is handed out in order and reclaimed once the timeline of the queue that read it reaches the
+	// value of the submission, so staging doesn't allocate anything once the ring exists
+	class StagingRing
+	{
+	public:
+		static void Init(VkDeviceSize capacity);
+		static void Shutdown();
+
+		// Waits for older uploads to finish when the ring is full, flushing the open immediate commands batch if that's what
+		// fills it. Data that doesn't fit (bigger than the ring) gets a temporary buffer instead
+		static StagingAllocation Allocate(VkDeviceSize size);
+		// The allocations made since the last call are read by the submission that signals value on timeline
+		static void Submitted(uint64_t value, Ref<Timeline> timeline);
+	};
+}
@@ -5,11 +5,89 @@
 #include <Structures/Buffer.h>
 #include <Structures/Vertex.h>
 
+#include <cfloat>
+
 #define TINYOBJLOADER_IMPLEMENTATION
 #include <tiny_obj_loader.h>
 
 namespace Low
 {
+	// Cells per axis of the grid used for the first simplified level, halved for every next one
+	static const uint32_t s_LodGridSize = 32;
+	// A level is only kept if it has at most this fraction of the triangles of the previous one
+	static const float s_LodMinReduction = 0.75f;
+
+	// Vertex clustering: the vertices falling in the same cell of a grid laid over the bounds collapse into the one closest to
+	// the average of the cell, and the triangles left with less than 3 distinct corners are dropped. Since the kept vertices
+	// are original ones, the result indexes the same vertex buffer
+	static std::vector<uint32_t> SimplifyMesh(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices,
+		const glm::vec3& min, const glm::vec3& max, uint32_t gridSize)
+	{
+		glm::vec3 cellSize = glm::max((max - min) / (float)gridSize, glm::vec3(FLT_EPSILON));
+
+		// Vertices facing different directions stay apart, so that thin walls keep both of their sides
+		auto cellKey = [&](const Vertex& v)
+		{
+			glm::uvec3 cell = glm::min(glm::uvec3((v.Position - min) / cellSize), glm::uvec3(gridSize - 1));
+			glm::vec3 n = glm::abs(v.Normal);
+			uint32_t axis = n.x >= n.y && n.x >= n.z ? 0 : (n.y >= n.z ? 1 : 2);
+			uint32_t direction = axis * 2 + (v.Normal[axis] < 0.0f ? 1 : 0);
+
+			return ((uint64_t)(cell.x + gridSize * (cell.y + gridSize * cell.z)) << 3) | direction;
+		};
+
+		std::unordered_map<uint64_t, uint32_t> cellIndices;
+		std::vector<uint32_t> vertexCells(vertices.size());
+		std::vector<glm::vec3> centers;
+		std::vector<uint32_t> counts;
+		for (uint32_t i = 0; i < vertices.size(); i++)
+		{
+			auto it = cellIndices.emplace(cellKey(vertices[i]), (uint32_t)centers.size());
+			if (it.second)
+			{
+				centers.push_back(glm::vec3(0.0f));
+				counts.push_back(0);
+			}
+
+			uint32_t cell = it.first->second;
+			vertexCells[i] = cell;
+			centers[cell] += vertices[i].Position;
+			counts[cell]++;
+		}
+
+		std::vector<uint32_t> representatives(centers.size(), 0);
+		std::vector<float> distances(centers.size(), FLT_MAX);
+		for (uint32_t i = 0; i < vertices.size(); i++)
+		{
+			uint32_t cell = vertexCells[i];
+			glm::vec3 offset = vertices[i].Position - centers[cell] / (float)counts[cell];
+			float distance = glm::dot(offset, offset);
+
+			if (distance < distances[cell])
+			{
+				distances[cell] = distance;
+				representatives[cell] = i;
+			}
+		}
+
+		std::vector<uint32_t> simplified;
+		for (uint32_t i = 0; i + 2 < indices.size(); i += 3)
+		{
+			uint32_t a = representatives[vertexCells[indices[i]]];
+			uint32_t b = representatives[vertexCells[indices[i + 1]]];
+			uint32_t c = representatives[vertexCells[indices[i + 2]]];
+
+			if (a != b && b != c && a != c)
+			{
+				simplified.push_back(a);
+				simplified.push_back(b);
+				simplified.push_back(c);
+			}
+		}
+
+		return simplified;
+	}
+
 	Mesh::Mesh(const std::string& path)
 	{
 		tinyobj::attrib_t attrib;
@@ -60,6 +138,34 @@ namespace Low
 			}
 		}
 
+		// Center the sphere on the bounding box, then grow it to contain every vertex
+		glm::vec3 min(FLT_MAX), max(-FLT_MAX);
+		for (const auto& v : vertices)
+		{
+			min = glm::min(min, v.Position);
+			max = glm::max(max, v.Position);
+		}
+
+		glm::vec3 center = vertices.empty() ? glm::vec3(0.0f) : (min + max) * 0.5f;
+		float radius = 0.0f;
+		for (const auto& v : vertices)
+			radius = std::max(radius, glm::length(v.Position - center));
+		m_BoundingSphere = glm::vec4(center, radius);
+
+		// Coarser and coarser grids, skipping the ones that barely simplify the previous level
+		m_Lods.push_back({ 0, (uint32_t)indices.size() });
+		std::vector<uint32_t> levelIndices = indices;
+		for (uint32_t gridSize = s_LodGridSize; gridSize >= 2 && m_Lods.size() < MaxLods && !vertices.empty(); gridSize /= 2)
+		{
+			std::vector<uint32_t> simplified = SimplifyMesh(vertices, levelIndices, min, max, gridSize);
+			if (simplified.empty() || simplified.size() > levelIndices.size() * s_LodMinReduction)
+				continue;
+
+			m_Lods.push_back({ (uint32_t)indices.size(), (uint32_t)simplified.size() });
+			indices.insert(indices.end(), simplified.begin(), simplified.end());
+			levelIndices = std::move(simplified);
+		}
+
 		m_VertexBuffer = CreateRef<Buffer>(vertices.size() * sizeof(Vertex), vertices.data(), BufferUsage::Vertex);
 		m_IndexBuffer = CreateRef<Buffer>(indices.size() * sizeof(uint32_t), indices.data(), BufferUsage::Index);
 	}
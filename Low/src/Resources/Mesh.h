@@ -4,16 +4,35 @@ namespace Low
 {
 	class Buffer;
 
+	// Range of the index buffer drawn for a level of detail. Every level indexes the same vertex buffer
+	struct MeshLod
+	{
+		uint32_t FirstIndex;
+		uint32_t IndexCount;
+	};
+
 	class Mesh
 	{
 	public:
+		static const uint32_t MaxLods = 4;
+
+		// Simplified levels of detail are generated on load and stored after the full mesh, in the same index buffer
 		Mesh(const std::string& path);
 
 		inline Ref<Buffer> VertexBuffer() { return m_VertexBuffer; }
 		inline Ref<Buffer> IndexBuffer() { return m_IndexBuffer; }
+		// Local space bounding sphere: xyz is the center, w the radius
+		inline glm::vec4 BoundingSphere() const { return m_BoundingSphere; }
+
+		// Level 0 is the full mesh, every next level has fewer triangles
+		inline uint32_t LodCount() const { return (uint32_t)m_Lods.size(); }
+		inline const MeshLod& Lod(uint32_t level) const { return m_Lods[level]; }
 
 	private:
 		Ref<Buffer> m_VertexBuffer;
 		Ref<Buffer> m_IndexBuffer;
+		std::vector<MeshLod> m_Lods;
+
+		glm::vec4 m_BoundingSphere;
 	};
 }
\ No newline at end of file
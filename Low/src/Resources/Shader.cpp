@@ -12,45 +12,61 @@
 
 namespace Low
 {
-	Shader::Shader(const std::string& shaderName) : m_Name(shaderName)
-	{
-		std::string vertPath = "../../Assets/Shaders/" + shaderName + ".vert";
-		std::string fragPath = "../../Assets/Shaders/" + shaderName + ".frag";
-
-		std::ifstream vertFile(vertPath), fragFile(fragPath);
-		if (!vertFile.is_open())
-			throw std::runtime_error("Coudln't find vertex shader file");
-		if (!fragFile.is_open())
-			throw std::runtime_error("Coudln't find fragment shader file");
-
-		if (!vertFile.good())
-			std::cout << "Vert not good" << std::endl;
+	Shader::Shader(const std::string& shaderName) : Shader(shaderName, shaderName) {}
 
+	Shader::Shader(const std::string& vertName, const std::string& fragName) : m_Name(vertName)
+	{
 		// Get shader source
-		std::string vertSource, fragSource;
-		std::stringstream ss;
-		ss << vertFile.rdbuf();
-		vertSource = ss.str();
-
-		ss.str("");
-		ss << fragFile.rdbuf();
-		fragSource = ss.str();
+		std::string vertSource = ReadSource("../../Assets/Shaders/" + vertName + ".vert");
+		std::string fragSource = ReadSource("../../Assets/Shaders/" + fragName + ".frag");
 
 		// Compile and link
-		std::vector<uint32_t> vertSpirv, fragSpirv;
-		Compile(vertSource, fragSource, vertSpirv, fragSpirv);
+		std::vector<uint32_t> vertSpirv = Compile(vertSource, ShaderStage::Vertex, vertName + ".vert");
+		std::vector<uint32_t> fragSpirv = Compile(fragSource, ShaderStage::Fragment, fragName + ".frag");
 
 		// Create actual vulkan shader
-		CreateVkShader(vertSpirv, fragSpirv);
+		m_VertModule = CreateVkShader(vertSpirv);
+		m_FragModule = CreateVkShader(fragSpirv);
+	}
+
+	Shader::Shader(const std::string& shaderName, ShaderStage stage) : m_Name(shaderName)
+	{
+		if (stage == ShaderStage::Vertex)
+		{
+			std::string vertSource = ReadSource("../../Assets/Shaders/" + shaderName + ".vert");
+			m_VertModule = CreateVkShader(Compile(vertSource, ShaderStage::Vertex, shaderName + ".vert"));
+			return;
+		}
+
+		if (stage != ShaderStage::Compute)
+			throw std::runtime_error("Only compute and vertex shaders can be created from a single stage");
+
+		std::string compSource = ReadSource("../../Assets/Shaders/" + shaderName + ".comp");
+		m_CompModule = CreateVkShader(Compile(compSource, ShaderStage::Compute, shaderName + ".comp"));
 	}
 
 	Shader::~Shader()
 	{
-		vkDestroyShaderModule(VulkanCore::Device(), m_FragModule, nullptr);
-		vkDestroyShaderModule(VulkanCore::Device(), m_VertModule, nullptr);
+		if (m_CompModule != VK_NULL_HANDLE)
+			vkDestroyShaderModule(VulkanCore::Device(), m_CompModule, nullptr);
+		if (m_FragModule != VK_NULL_HANDLE)
+			vkDestroyShaderModule(VulkanCore::Device(), m_FragModule, nullptr);
+		if (m_VertModule != VK_NULL_HANDLE)
+			vkDestroyShaderModule(VulkanCore::Device(), m_VertModule, nullptr);
+	}
+
+	std::string Shader::ReadSource(const std::string& path)
+	{
+		std::ifstream file(path);
+		if (!file.is_open())
+			throw std::runtime_error("Coudln't find shader file " + path);
+
+		std::stringstream ss;
+		ss << file.rdbuf();
+		return ss.str();
 	}
 
-	void Shader::Compile(const std::string& vertSrc, const std::string& fragSrc, std::vector<uint32_t>& vertBin, std::vector<uint32_t>& fragBin)
+	std::vector<uint32_t> Shader::Compile(const std::string& src, ShaderStage stage, const std::string& fileName)
 	{
 		shaderc::Compiler compiler;
 		shaderc::CompileOptions options = {};
@@ -64,40 +80,37 @@ namespace Low
 		if (optimize)
 			options.SetOptimizationLevel(shaderc_optimization_level_size);
 		options.SetForcedVersionProfile(450, shaderc_profile::shaderc_profile_none);
-		
-		shaderc::SpvCompilationResult vertModule = compiler.CompileGlslToSpv(vertSrc, shaderc_shader_kind::shaderc_glsl_vertex_shader, (m_Name + ".vert").c_str(), options);
-		if (vertModule.GetCompilationStatus() != shaderc_compilation_status_success)
+
+		shaderc_shader_kind kind;
+		switch (stage)
 		{
-			std::cerr << "Shader " << m_Name << " failed to compile: " << vertModule.GetErrorMessage() << std::endl;
-			throw std::runtime_error("Vertex shader failed to compile");
+		case ShaderStage::Vertex:	kind = shaderc_shader_kind::shaderc_glsl_vertex_shader; break;
+		case ShaderStage::Fragment:	kind = shaderc_shader_kind::shaderc_fragment_shader; break;
+		case ShaderStage::Compute:	kind = shaderc_shader_kind::shaderc_compute_shader; break;
+		default: throw std::runtime_error("Unsupported shader stage");
 		}
 
-		shaderc::SpvCompilationResult fragModule = compiler.CompileGlslToSpv(fragSrc, shaderc_shader_kind::shaderc_fragment_shader, (m_Name + ".frag").c_str(), options);
-		if (fragModule.GetCompilationStatus() != shaderc_compilation_status_success)
+		shaderc::SpvCompilationResult module = compiler.CompileGlslToSpv(src, kind, fileName.c_str(), options);
+		if (module.GetCompilationStatus() != shaderc_compilation_status_success)
 		{
-			std::cerr << "Shader " << m_Name << " failed to compile: " << fragModule.GetErrorMessage() << std::endl;
-			throw std::runtime_error("Fragment shader failed to compile");
+			std::cerr << "Shader " << fileName << " failed to compile: " << module.GetErrorMessage() << std::endl;
+			throw std::runtime_error("Shader failed to compile");
 		}
 
-		vertBin = { vertModule.cbegin(), vertModule.cend() };
-		fragBin = { fragModule.cbegin(), fragModule.cend() };
+		return { module.cbegin(), module.cend() };
 	}
 
-	void Shader::CreateVkShader(const std::vector<uint32_t>& vertSpirv, const std::vector<uint32_t>& fragSpirv)
+	VkShaderModule Shader::CreateVkShader(const std::vector<uint32_t>& spirv)
 	{
-		VkShaderModuleCreateInfo vertShaderInfo = {};
-		vertShaderInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
-		vertShaderInfo.codeSize = vertSpirv.size() * sizeof(uint32_t);
-		vertShaderInfo.pCode = vertSpirv.data();
-
-		VkShaderModuleCreateInfo fragShaderInfo = {};
-		fragShaderInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
-		fragShaderInfo.codeSize = fragSpirv.size() * sizeof(uint32_t);
-		fragShaderInfo.pCode = fragSpirv.data();
-
-		if (vkCreateShaderModule(VulkanCore::Device(), &vertShaderInfo, nullptr, &m_VertModule) != VK_SUCCESS)
-			std::cout << "Failed creating vertex shader" << std::endl;
-		if (vkCreateShaderModule(VulkanCore::Device(), &fragShaderInfo, nullptr, &m_FragModule) != VK_SUCCESS)
-			std::cout << "Failed creating fragment shader" << std::endl;
+		VkShaderModuleCreateInfo shaderInfo = {};
+		shaderInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+		shaderInfo.codeSize = spirv.size() * sizeof(uint32_t);
+		shaderInfo.pCode = spirv.data();
+
+		VkShaderModule ret = VK_NULL_HANDLE;
+		if (vkCreateShaderModule(VulkanCore::Device(), &shaderInfo, nullptr, &ret) != VK_SUCCESS)
+			std::cout << "Failed creating " << m_Name << " shader module" << std::endl;
+
+		return ret;
 	}
-}
\ No newline at end of file
+}
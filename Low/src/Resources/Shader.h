@@ -1,23 +1,33 @@
 #pragma once
 
+#include <Utils/Rendering/UniformTypes.h>
+
 namespace Low
 {
 	class Shader
 	{
 	public:
 		Shader(const std::string& shaderName);
+		// Stages coming from different files, so that a vertex shader can be paired with an existing fragment shader
+		Shader(const std::string& vertName, const std::string& fragName);
+		// Loads <shaderName>.comp for ShaderStage::Compute, or <shaderName>.vert for ShaderStage::Vertex: vertex only shaders
+		// are used by pipelines without a fragment stage
+		Shader(const std::string& shaderName, ShaderStage stage);
 		~Shader();
 
 		inline VkShaderModule GetVertexModule() { return m_VertModule; }
 		inline VkShaderModule GetFragmentModule() { return m_FragModule; }
+		inline VkShaderModule GetComputeModule() { return m_CompModule; }
 
 	private:
-		void Compile(const std::string& vertSrc, const std::string& fragSrc, std::vector<uint32_t>& vertBin, std::vector<uint32_t>& fragBin);
-		void CreateVkShader(const std::vector<uint32_t>& vertSpirv, const std::vector<uint32_t>& fragSpirv);
+		std::string ReadSource(const std::string& path);
+		std::vector<uint32_t> Compile(const std::string& src, ShaderStage stage, const std::string& fileName);
+		VkShaderModule CreateVkShader(const std::vector<uint32_t>& spirv);
 	private:
 		std::string m_Name;
 
-		VkShaderModule m_VertModule;
-		VkShaderModule m_FragModule;
+		VkShaderModule m_VertModule = VK_NULL_HANDLE;
+		VkShaderModule m_FragModule = VK_NULL_HANDLE;
+		VkShaderModule m_CompModule = VK_NULL_HANDLE;
 	};
 }
\ No newline at end of file
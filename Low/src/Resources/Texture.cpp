@@ -1,9 +1,10 @@
 #include <Resources/Texture.h>
-#include <Structures/Buffer.h>
+#include <Rendering/StagingRing.h>
 #include <Hardware/Memory.h>
 
 #include <Vulkan/VulkanCore.h>
 #include <Vulkan/Command/ImmediateCommands.h>
+#include <Vulkan/Command/TransferCommands.h>
 
 #include <stb_image.h>
 
@@ -18,19 +19,8 @@ namespace Low
 		stbi_uc* pixels = stbi_load(path.c_str(), &m_Width, &m_Height, &m_ChannelCount, STBI_rgb_alpha);
 		VkDeviceSize size = m_Width * m_Height * 4;
 
-		// Read image and store data into buffers
-		m_Buffer = CreateRef<Low::Buffer>(size, BufferUsage::TransferSrc);
-
-		void* data;
-		vkMapMemory(VulkanCore::Device(), m_Buffer->Memory(), 0, size, 0, &data);
-		memcpy(data, pixels, size);
-		vkUnmapMemory(VulkanCore::Device(), m_Buffer->Memory());
-
-		stbi_image_free(pixels);
-
 		// Create texture image
 		m_Image = {};
-		m_Memory = {};
 
 		VkImageCreateInfo texInfo = {};
 		texInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
@@ -51,18 +41,7 @@ namespace Low
 		if (vkCreateImage(VulkanCore::Device(), &texInfo, nullptr, &m_Image) != VK_SUCCESS)
 			throw std::runtime_error("Couldn't create texture image");
 
-		VkMemoryRequirements memoryReqs;
-		vkGetImageMemoryRequirements(VulkanCore::Device(), m_Image, &memoryReqs);
-
-		VkMemoryAllocateInfo allocInfo = {};
-		allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-		allocInfo.allocationSize = memoryReqs.size;
-		allocInfo.memoryTypeIndex = Memory::FindMemoryType(VulkanCore::PhysicalDevice(), memoryReqs.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
-
-		if (vkAllocateMemory(VulkanCore::Device(), &allocInfo, nullptr, &m_Memory) != VK_SUCCESS)
-			throw std::runtime_error("Couldn't allocate texture memory");
-
-		vkBindImageMemory(VulkanCore::Device(), m_Image, m_Memory, 0);
+		m_Allocation = Memory::AllocateImage(m_Image, MemoryUsage::GpuOnly, m_Tiling);
 
 		VkImageViewCreateInfo viewInfo{};
 		viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
@@ -104,8 +83,25 @@ namespace Low
 		if (vkCreateSampler(VulkanCore::Device(), &samplerInfo, nullptr, &m_Sampler) != VK_SUCCESS)
 			throw std::runtime_error("Couldn't create sampler");
 
+		// The transfer queue does the layout transitions itself
+		if (TransferCommands::Available())
+		{
+			StagingAllocation staging = StagingRing::Allocate(size);
+			memcpy(staging.Data, pixels, size);
+			stbi_image_free(pixels);
+
+			TransferCommands::CopyBufferToImage(m_Image, staging.Buffer, m_Width, m_Height, staging.Offset);
+			return;
+		}
+
 		ImmediateCommands::TransitionImageLayout(m_Image, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
-		ImmediateCommands::CopyBufferToImage(m_Image, *m_Buffer, m_Width, m_Height);
+
+		// Staged right before the copy, so that the ring space is tagged with the submission that reads it
+		StagingAllocation staging = StagingRing::Allocate(size);
+		memcpy(staging.Data, pixels, size);
+		stbi_image_free(pixels);
+
+		ImmediateCommands::CopyBufferToImage(m_Image, staging.Buffer, m_Width, m_Height, staging.Offset);
 		ImmediateCommands::TransitionImageLayout(m_Image, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
 	}
 
@@ -114,6 +110,6 @@ namespace Low
 		vkDestroyImageView(VulkanCore::Device(), m_ImageView, nullptr);
 		vkDestroySampler(VulkanCore::Device(), m_Sampler, nullptr);
 		vkDestroyImage(VulkanCore::Device(), m_Image, nullptr);
-		vkFreeMemory(VulkanCore::Device(), m_Memory, nullptr);
+		Memory::Free(m_Allocation);
 	}
 }
\ No newline at end of file
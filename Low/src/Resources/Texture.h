@@ -1,9 +1,9 @@
 #pragma once
 
+#include <Hardware/Memory.h>
+
 namespace Low
 {
-	class Buffer;
-
 	class Texture
 	{
 	public:
@@ -11,10 +11,9 @@ namespace Low
 		~Texture();
 
 		inline VkImage Handle() { return m_Image; }
-		inline VkDeviceMemory Memory() { return m_Memory; }
+		inline const MemoryAllocation& Allocation() { return m_Allocation; }
 		inline VkSampler* Sampler() { return &m_Sampler; }
 		inline VkImageView ImageView() { return m_ImageView; }
-		inline Ref<Buffer> Buffer() { return m_Buffer; }
 
 		inline uint32_t GetWidth() { return m_Width; }
 		inline uint32_t GetHeight() { return m_Height; }
@@ -30,8 +29,7 @@ namespace Low
 		VkImageView m_ImageView;
 		VkSampler m_Sampler;
 
-		VkDeviceMemory m_Memory;
-		Ref<Low::Buffer> m_Buffer;
+		MemoryAllocation m_Allocation;
 
 		VkFormat m_Format;
 		VkImageTiling m_Tiling;
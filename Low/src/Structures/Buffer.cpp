@@ -3,6 +3,8 @@
 
 #include <Vulkan/VulkanCore.h>
 #include <Vulkan/Command/ImmediateCommands.h>
+#include <Vulkan/Command/TransferCommands.h>
+#include <Rendering/StagingRing.h>
 
 #include <stdexcept>
 
@@ -17,15 +19,20 @@ namespace Low
 	{
 		Init(size, usage);
 
-		void* tmpData;
-		Buffer stagingBuffer(size, BufferUsage::TransferSrc);
+		// GPU only memory is host visible on integrated GPUs: no need to stage there, as long as nothing has to be flushed
+		if (Mapped() && Allocation().Coherent)
+		{
+			memcpy(Mapped(), data, (size_t)size);
+			return;
+		}
 
-		if (vkMapMemory(VulkanCore::Device(), stagingBuffer.Memory(), 0, size, 0, &tmpData) != VK_SUCCESS)
-			std::cout << "Mapping failed" << std::endl;
-		memcpy(tmpData, data, (size_t)size);
-		vkUnmapMemory(VulkanCore::Device(), stagingBuffer.Memory());
+		StagingAllocation staging = StagingRing::Allocate(size);
+		memcpy(staging.Data, data, (size_t)size);
 
-		ImmediateCommands::CopyBuffer(m_Handle, stagingBuffer, size);
+		if (TransferCommands::Available())
+			TransferCommands::CopyBuffer(m_Handle, staging.Buffer, size, staging.Offset);
+		else
+			ImmediateCommands::CopyBuffer(m_Handle, staging.Buffer, size, staging.Offset);
 	}
 
 	void Buffer::Init(uint32_t size, BufferUsage usage)
@@ -42,41 +49,40 @@ namespace Low
 		case BufferUsage::Vertex:		createInfo.usage = VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT; break;
 		case BufferUsage::Index:		createInfo.usage = VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT; break;
 		case BufferUsage::Uniform:		createInfo.usage = VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT; break;
+		case BufferUsage::Storage:		createInfo.usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT; break;
+		case BufferUsage::Indirect:		createInfo.usage = VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT; break;
+		case BufferUsage::Instance:		createInfo.usage = VK_BUFFER_USAGE_VERTEX_BUFFER_BIT; break;
+		case BufferUsage::Transient:	createInfo.usage = VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT |
+			VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT; break;
+		case BufferUsage::DeviceStorage:	createInfo.usage = VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT; break;
 		default: break;
 		}
 
 		if (vkCreateBuffer(VulkanCore::Device(), &createInfo, nullptr, &m_Handle) != VK_SUCCESS)
 			throw std::runtime_error("Couldn't create buffer");
 
-		VkMemoryRequirements memRequirements = {};
-		vkGetBufferMemoryRequirements(VulkanCore::Device(), m_Handle, &memRequirements);
-
-		VkMemoryAllocateInfo allocateInfo = {};
-		allocateInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-		allocateInfo.allocationSize = memRequirements.size;
-
-		VkMemoryPropertyFlags memoryProps = 0;
+		MemoryUsage memoryUsage = MemoryUsage::GpuOnly;
 		switch (usage)
 		{
-		case BufferUsage::TransferDst:
-		case BufferUsage::TransferSrc:	memoryProps = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT; break;
-		case BufferUsage::Vertex:		memoryProps = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT; break;
-		case BufferUsage::Index:		memoryProps = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT; break;
-		case BufferUsage::Uniform:		memoryProps = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT; break;
+		case BufferUsage::TransferSrc:	memoryUsage = MemoryUsage::Upload; break;
+		case BufferUsage::TransferDst:	memoryUsage = MemoryUsage::Readback; break;
+		case BufferUsage::Vertex:		memoryUsage = MemoryUsage::GpuOnly; break;
+		case BufferUsage::Index:		memoryUsage = MemoryUsage::GpuOnly; break;
+		case BufferUsage::Uniform:		memoryUsage = MemoryUsage::Dynamic; break;
+		case BufferUsage::Storage:		memoryUsage = MemoryUsage::Dynamic; break;
+		case BufferUsage::Indirect:		memoryUsage = MemoryUsage::GpuOnly; break;
+		case BufferUsage::Instance:		memoryUsage = MemoryUsage::Dynamic; break;
+		case BufferUsage::Transient:	memoryUsage = MemoryUsage::Dynamic; break;
+		case BufferUsage::DeviceStorage:	memoryUsage = MemoryUsage::GpuOnly; break;
 		default: break;
 		}
 
-		allocateInfo.memoryTypeIndex = Memory::FindMemoryType(VulkanCore::PhysicalDevice(), memRequirements.memoryTypeBits, memoryProps);
-
-		if (vkAllocateMemory(VulkanCore::Device(), &allocateInfo, nullptr, &m_Memory) != VK_SUCCESS)
-			throw std::runtime_error("Couldn't allocate memory for the vertex buffer");
-		if (vkBindBufferMemory(VulkanCore::Device(), m_Handle, m_Memory, 0) != VK_SUCCESS)
-			throw std::runtime_error("Couldn't bind memory to buffer");
+		m_Allocation = Memory::AllocateBuffer(m_Handle, memoryUsage);
 	}
 
 	Buffer::~Buffer()
 	{
 		vkDestroyBuffer(VulkanCore::Device(), m_Handle, nullptr);
-		vkFreeMemory(VulkanCore::Device(), m_Memory, nullptr);
+		Memory::Free(m_Allocation);
 	}
 }
\ No newline at end of file
@@ -1,10 +1,14 @@
 #pragma once
 
 #include <glm/glm.hpp>
+#include <Hardware/Memory.h>
 
 namespace Low
 {
-	enum class BufferUsage {TransferSrc = 0, TransferDst, Vertex, Index, Uniform };
+	// Storage, Instance and Transient buffers are host visible and written by the CPU every frame, Indirect and DeviceStorage
+	// buffers are device local and written by compute shaders. Transient buffers back the FrameAllocator and can be bound in
+	// any role
+	enum class BufferUsage {TransferSrc = 0, TransferDst, Vertex, Index, Uniform, Storage, Indirect, Instance, Transient, DeviceStorage };
 
 	class Buffer
 	{
@@ -15,7 +19,10 @@ namespace Low
 
 		~Buffer();
 		
-		inline VkDeviceMemory Memory() { return m_Memory; }
+		inline const MemoryAllocation& Allocation() { return m_Allocation; }
+		// Persistently mapped contents, always there for TransferSrc, TransferDst, Uniform, Storage, Instance and Transient
+		// buffers. The others are only mapped when their memory happens to be host visible (integrated GPUs)
+		inline void* Mapped() { return m_Allocation.Mapped; }
 
 		inline size_t Size() { return m_Size; }
 		void SetData(void* data);
@@ -27,7 +34,7 @@ namespace Low
 
 	private:
 		VkBuffer m_Handle;
-		VkDeviceMemory m_Memory;
+		MemoryAllocation m_Allocation;
 
 		size_t m_Size;
 	};
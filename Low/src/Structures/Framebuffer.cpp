@@ -52,7 +52,11 @@ namespace Low
 				texInfo.format = config.Format;
 				texInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
 				texInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-				texInfo.usage = VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
+				// Offscreen color targets can be copied back to the host or sampled by later passes
+				if (config.Type == AttachmentType::Color)
+					texInfo.usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+				else
+					texInfo.usage = VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
 				texInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
 				texInfo.samples = (VkSampleCountFlagBits)(VK_SAMPLE_COUNT_1_BIT + config.SampleCount - 1);
 				texInfo.flags = 0;
@@ -62,20 +66,7 @@ namespace Low
 
 				//ImmediateCommands::TransitionImageLayout(attachment.Image, texInfo.format, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR);
 
-				VkMemoryRequirements memoryReqs;
-				vkGetImageMemoryRequirements(VulkanCore::Device(), attachment.Image, &memoryReqs);
-
-				VkMemoryAllocateInfo allocInfo = {};
-				VkDeviceMemory memory = {};
-				allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-				allocInfo.allocationSize = memoryReqs.size;
-				allocInfo.memoryTypeIndex = Memory::FindMemoryType(VulkanCore::PhysicalDevice(), memoryReqs.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
-
-				if (vkAllocateMemory(VulkanCore::Device(), &allocInfo, nullptr, &memory) != VK_SUCCESS)
-					throw std::runtime_error("Couldn't allocate texture memory");
-
-				vkBindImageMemory(VulkanCore::Device(), attachment.Image, memory, 0);
-				attachment.ImageMemory = memory;
+				attachment.ImageMemory = Memory::AllocateImage(attachment.Image);
 			}
 
 			VkImageViewCreateInfo createInfo = {};
@@ -105,6 +96,11 @@ namespace Low
 			// TransitionImageToLayout(s_Data.DepthImage, depthFormat, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL);
 		}
 
+		// Render passes without a render pass object (dynamic rendering) use the views directly
+		m_Handle = VK_NULL_HANDLE;
+		if (renderPass == VK_NULL_HANDLE)
+			return;
+
 		std::vector<VkImageView> attachments(m_Attachments.size());
 		for (uint32_t i = 0; i < attachments.size(); i++)
 			attachments[i] = m_Attachments[i].ImageView;
@@ -129,9 +125,10 @@ namespace Low
 			if (!attachment.Specs.IsSwapchain)
 				vkDestroyImage(VulkanCore::Device(), attachment.Image, nullptr);
 			vkDestroyImageView(VulkanCore::Device(), attachment.ImageView, nullptr);
-			vkFreeMemory(VulkanCore::Device(), attachment.ImageMemory, nullptr);
+			Memory::Free(attachment.ImageMemory);
 		}
 
-		vkDestroyFramebuffer(VulkanCore::Device(), m_Handle, nullptr);
+		if (m_Handle != VK_NULL_HANDLE)
+			vkDestroyFramebuffer(VulkanCore::Device(), m_Handle, nullptr);
 	}
 }
\ No newline at end of file
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <Hardware/Memory.h>
+
 namespace Low
 {
 	enum class AttachmentType {None = 0, Color, Depth};
@@ -41,7 +43,8 @@ namespace Low
 			else if (Type == AttachmentType::Depth)
 			{
 				description.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
-				description.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+				// Kept for the passes reading depth after the geometry pass
+				description.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
 				description.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
 				description.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
 				description.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
@@ -65,7 +68,7 @@ namespace Low
 	{
 		FramebufferAttachmentSpecs Specs;
 
-		VkDeviceMemory ImageMemory = VK_NULL_HANDLE;
+		MemoryAllocation ImageMemory;
 		VkImage Image = VK_NULL_HANDLE;
 		VkImageView ImageView = VK_NULL_HANDLE;
 
@@ -81,7 +84,9 @@ namespace Low
 			std::vector<VkImage> images);
 		~Framebuffer();
 
+		// VK_NULL_HANDLE with dynamic rendering, which only needs the attachments
 		inline VkFramebuffer Handle() { return m_Handle; }
+		inline const std::vector<FramebufferAttachment>& Attachments() const { return m_Attachments; }
 
 		inline std::vector<VkAttachmentDescription> Descriptions() 
 		{
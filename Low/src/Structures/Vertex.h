@@ -56,6 +56,35 @@ namespace Low
 			return Position == other.Position && Color == other.Color && TexCoord == other.TexCoord;
 		}
 	};
+
+	// Per-instance data, read from the second vertex binding. Transforms live in the object buffer, instances only
+	// store where to find them
+	struct InstanceData
+	{
+		uint32_t ObjectIndex;
+
+		static VkVertexInputBindingDescription GetInstanceBindingDescription()
+		{
+			VkVertexInputBindingDescription bindingDescription = {};
+			bindingDescription.binding = 1;
+			bindingDescription.stride = sizeof(InstanceData);
+			bindingDescription.inputRate = VK_VERTEX_INPUT_RATE_INSTANCE;
+
+			return bindingDescription;
+		}
+
+		static std::vector<VkVertexInputAttributeDescription> GetInstanceAttributeDescriptions()
+		{
+			std::vector<VkVertexInputAttributeDescription> ret(1);
+
+			ret[0].binding = 1;
+			ret[0].format = VK_FORMAT_R32_UINT;
+			ret[0].offset = 0;
+			ret[0].location = 4;
+
+			return ret;
+		}
+	};
 }
 
 namespace std {
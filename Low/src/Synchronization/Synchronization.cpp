@@ -26,50 +26,94 @@ namespace Low
 
 	Semaphore::operator VkSemaphore() { return m_Handles[State::CurrentFramebufferIndex()]; }
 
-	/********************************************************FENCE**********************************************************/
+	/********************************************************TIMELINE**********************************************************/
 
-	Fence::Fence(uint32_t framesInFlight)
+	Timeline::Timeline()
 	{
-		m_Handles.resize(framesInFlight);
+		VkSemaphoreTypeCreateInfo typeInfo = {};
+		typeInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+		typeInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+		typeInfo.initialValue = 0;
+
+		VkSemaphoreCreateInfo semInfo = {};
+		semInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+		semInfo.pNext = &typeInfo;
 
-		VkFenceCreateInfo fenceInfo = {};
-		fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
-		fenceInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
+		if (vkCreateSemaphore(VulkanCore::Device(), &semInfo, nullptr, &m_Handle) != VK_SUCCESS)
+			throw std::runtime_error("Couldn't create timeline semaphore");
+	}
 
-		for (uint32_t i = 0; i < framesInFlight; i++)
-			vkCreateFence(VulkanCore::Device(), &fenceInfo, nullptr, &m_Handles[i]);
+	Timeline::~Timeline()
+	{
+		vkDestroySemaphore(VulkanCore::Device(), m_Handle, nullptr);
+	}
+
+	uint64_t Timeline::Advance()
+	{
+		return ++m_Submitted;
+	}
+
+	void Timeline::UpdateCompleted(uint64_t value)
+	{
+		uint64_t current = m_Completed.load();
+		while (current < value && !m_Completed.compare_exchange_weak(current, value));
+	}
+
+	uint64_t Timeline::Completed()
+	{
+		uint64_t value;
+		if (vkGetSemaphoreCounterValue(VulkanCore::Device(), m_Handle, &value) == VK_SUCCESS)
+			UpdateCompleted(value);
+		return m_Completed.load();
 	}
 
-	Fence::~Fence()
+	bool Timeline::IsComplete(uint64_t value)
 	{
-		for (auto& fen : m_Handles)
-			vkDestroyFence(VulkanCore::Device(), fen, nullptr);
+		return value <= m_Completed.load() || value <= Completed();
 	}
 
-	Fence::operator VkFence() { return m_Handles[State::CurrentFramebufferIndex()]; }
+	void Timeline::Wait(uint64_t value)
+	{
+		if (value <= m_Completed.load())
+			return;
+
+		VkSemaphoreWaitInfo waitInfo = {};
+		waitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+		waitInfo.semaphoreCount = 1;
+		waitInfo.pSemaphores = &m_Handle;
+		waitInfo.pValues = &value;
+
+		if (vkWaitSemaphores(VulkanCore::Device(), &waitInfo, UINT64_MAX) != VK_SUCCESS)
+			throw std::runtime_error("Couldn't wait for the timeline semaphore");
+		UpdateCompleted(value);
+	}
 
 	/********************************************************BARRIER?**********************************************************/
 
 	/********************************************************SYNCHRONIZATION*********************************************************/
 
 	std::unordered_map<std::string, Ref<Semaphore>> Synchronization::s_Semaphores;
-	std::unordered_map<std::string, Ref<Fence>> Synchronization::s_Fences;
+	Ref<Timeline> Synchronization::s_FrameTimeline;
+	Ref<Timeline> Synchronization::s_TransferTimeline;
 	uint32_t Synchronization::s_FramesInFlight;
 
 	void Synchronization::Init(uint32_t inFlight)
 	{
 		s_FramesInFlight = inFlight;
+		s_FrameTimeline = CreateRef<Timeline>();
+		s_TransferTimeline = CreateRef<Timeline>();
 	}
 
-	Ref<Semaphore> Synchronization::CreateSemaphore(const std::string& name)
+	void Synchronization::Shutdown()
 	{
-		s_Semaphores[name] = CreateRef<Semaphore>(s_FramesInFlight);
-		return s_Semaphores[name];
+		s_Semaphores.clear();
+		s_FrameTimeline = nullptr;
+		s_TransferTimeline = nullptr;
 	}
 
-	Ref<Fence> Synchronization::CreateFence(const std::string& name)
+	Ref<Semaphore> Synchronization::CreateSemaphore(const std::string& name)
 	{
-		s_Fences[name] = CreateRef<Fence>(s_FramesInFlight);
-		return s_Fences[name];
+		s_Semaphores[name] = CreateRef<Semaphore>(s_FramesInFlight);
+		return s_Semaphores[name];
 	}
 }
\ No newline at end of file
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <atomic>
+
 namespace Low
 {
 	class Semaphore
@@ -19,33 +21,51 @@ namespace Low
 		std::vector<VkSemaphore> m_Handles;
 	};
 
-	class Fence
+	// Timeline semaphore tracking the progress of a queue: every submission signals the next value, so anything can check
+	// whether the work submitted up to a value has finished without a fence of its own. Values are handed out by the thread
+	// submitting to the queue, progress can be checked from any thread
+	class Timeline
 	{
 	public:
-		Fence(uint32_t framesInFlight);
-		Fence() = default;
-		Fence(const Fence& other) = default;
-		~Fence();
+		Timeline();
+		~Timeline();
 
-		void Wait();
-		void Signal();
+		// Value the next submission signals
+		uint64_t Advance();
+		// Last value handed to a submission: waiting for it waits for all the work submitted so far
+		inline uint64_t Submitted() const { return m_Submitted.load(); }
+		// Last value signaled by the GPU
+		uint64_t Completed();
+		bool IsComplete(uint64_t value);
+		void Wait(uint64_t value);
+
+		inline operator VkSemaphore() { return m_Handle; }
 
-		operator VkFence();
+	private:
+		// Only ever grows, even when threads race to update it
+		void UpdateCompleted(uint64_t value);
 
 	private:
-		std::vector<VkFence> m_Handles;
+		VkSemaphore m_Handle = VK_NULL_HANDLE;
+		std::atomic<uint64_t> m_Submitted = 0;
+		// Cached, so that checking values that are known to be done doesn't query the semaphore
+		std::atomic<uint64_t> m_Completed = 0;
 	};
 
 	class Synchronization
 	{
 	public:
 		static void Init(uint32_t framesInFlight);
+		static void Shutdown();
 
+		// Binary semaphores, one per frame in flight: only used to synchronize with the swapchain
 		static Ref<Semaphore> CreateSemaphore(const std::string& name);
-		static Ref<Fence> CreateFence(const std::string& name);
 
 		static inline void DeleteSemaphore(const std::string& name);
-		static inline void DeleteFence(const std::string& name);
+
+		static inline Ref<Timeline> FrameTimeline() { return s_FrameTimeline; }
+		// Signaled by the submissions of the transfer queue, which runs next to the graphics one
+		static inline Ref<Timeline> TransferTimeline() { return s_TransferTimeline; }
 
 		static inline Ref<Semaphore> GetSemaphore(const std::string& name) 
 		{ 
@@ -55,17 +75,10 @@ namespace Low
 			return nullptr;
 		}
 
-		static inline Ref<Fence> GetFence(const std::string& name)
-		{
-			if (s_Fences.find(name) != s_Fences.end())
-				return s_Fences[name];
-			std::cout << "ERROR: couldn't find fence " << name << std::endl;
-			return nullptr;
-		}
-	
 	private:
 		static std::unordered_map<std::string, Ref<Semaphore>> s_Semaphores;
-		static std::unordered_map<std::string, Ref<Fence>> s_Fences;
+		static Ref<Timeline> s_FrameTimeline;
+		static Ref<Timeline> s_TransferTimeline;
 		static uint32_t s_FramesInFlight;
 	};
 }
\ No newline at end of file
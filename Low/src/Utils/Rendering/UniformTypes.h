@@ -4,7 +4,7 @@
 
 namespace Low
 {
-	enum class DescriptorSetType { None = 0, Buffer, Sampler };
+	enum class DescriptorSetType { None = 0, Buffer, Sampler, StorageBuffer, DynamicBuffer, DynamicStorageBuffer, StorageImage };
 	enum class ShaderStage : uint32_t { None = 0, Vertex, Fragment, VertexFragment, Compute };
 
 	enum class UniformDataType { Invalid = 0, Bool, Float, Float2, Float3, Float4, Int, Int2, Int3, Int4, Mat3, Mat4, Texture };
@@ -51,6 +51,10 @@ namespace Low
 			{
 			case DescriptorSetType::Buffer: Handle.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER; break;
 			case DescriptorSetType::Sampler: Handle.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER; break;
+			case DescriptorSetType::StorageBuffer: Handle.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER; break;
+			case DescriptorSetType::DynamicBuffer: Handle.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC; break;
+			case DescriptorSetType::DynamicStorageBuffer: Handle.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC; break;
+			case DescriptorSetType::StorageImage: Handle.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE; break;
 			default:break;
 			}
 
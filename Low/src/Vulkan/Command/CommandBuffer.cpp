@@ -1,6 +1,8 @@
 #include <Vulkan/Command/CommandBuffer.h>
 #include <Vulkan/RenderPass.h>
 
+#include <Structures/Framebuffer.h>
+
 namespace Low
 {
 	CommandBuffer::CommandBuffer(VkCommandBuffer buf) : m_Handle(buf) {}
@@ -24,6 +26,34 @@ namespace Low
 		}
 	}
 
+	void CommandBuffer::BeginSecondary(RenderPass& renderPass, Framebuffer& framebuffer, VkQueryPipelineStatisticFlags pipelineStatistics)
+	{
+		VkCommandBufferInheritanceInfo inheritanceInfo = {};
+		inheritanceInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+		inheritanceInfo.renderPass = renderPass;
+		inheritanceInfo.subpass = 0;
+		inheritanceInfo.framebuffer = framebuffer.Handle();
+		inheritanceInfo.pipelineStatistics = pipelineStatistics;
+
+		// Without a render pass object, the secondary buffer only knows the formats of the attachments it renders to
+		VkCommandBufferInheritanceRenderingInfo renderingInfo = {};
+		renderingInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_RENDERING_INFO;
+		renderingInfo.colorAttachmentCount = renderPass.ColorFormats().size();
+		renderingInfo.pColorAttachmentFormats = renderPass.ColorFormats().data();
+		renderingInfo.depthAttachmentFormat = renderPass.DepthFormat();
+		renderingInfo.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+		if (inheritanceInfo.renderPass == VK_NULL_HANDLE)
+			inheritanceInfo.pNext = &renderingInfo;
+
+		VkCommandBufferBeginInfo beginInfo = {};
+		beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+		beginInfo.flags = VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT | VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+		beginInfo.pInheritanceInfo = &inheritanceInfo;
+
+		if (vkBeginCommandBuffer(m_Handle, &beginInfo) != VK_SUCCESS)
+			throw std::runtime_error("Couldn't begin recording secondary command buffer");
+	}
+
 	void CommandBuffer::End()
 	{
 		if (vkEndCommandBuffer(m_Handle) != VK_SUCCESS)
@@ -3,6 +3,7 @@
 namespace Low
 {
 	class RenderPass;
+	class Framebuffer;
 
 	class CommandBuffer
 	{
@@ -11,6 +12,9 @@ namespace Low
 
 		void Reset();
 		void Begin();
+		// Secondary buffers recorded to be executed inside the given render pass. pipelineStatistics must contain the flags of
+		// the statistics query active in the primary buffer when they're executed, if any
+		void BeginSecondary(RenderPass& renderPass, Framebuffer& framebuffer, VkQueryPipelineStatisticFlags pipelineStatistics = 0);
 		void End();
 
 		inline operator VkCommandBuffer() { return m_Handle; }
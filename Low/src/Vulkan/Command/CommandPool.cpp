@@ -22,7 +22,7 @@ namespace Low
 		vkDestroyCommandPool(VulkanCore::Device(), m_Handle, nullptr);
 	}
 
-	std::vector<Ref<CommandBuffer>> CommandPool::AllocateCommandBuffers(uint32_t count)
+	std::vector<Ref<CommandBuffer>> CommandPool::AllocateCommandBuffers(uint32_t count, VkCommandBufferLevel level)
 	{
 		std::vector<Ref<CommandBuffer>> ret;
 		std::vector<VkCommandBuffer> buffers;
@@ -34,7 +34,7 @@ namespace Low
 
 		allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
 		allocInfo.commandPool = m_Handle;
-		allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+		allocInfo.level = level;
 		allocInfo.commandBufferCount = count;
 
 		if (vkAllocateCommandBuffers(VulkanCore::Device(), &allocInfo, buffers.data()) != VK_SUCCESS) {
@@ -46,4 +46,9 @@ namespace Low
 
 		return ret;
 	}
+
+	void CommandPool::Reset()
+	{
+		vkResetCommandPool(VulkanCore::Device(), m_Handle, 0);
+	}
 }
\ No newline at end of file
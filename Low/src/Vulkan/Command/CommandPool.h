@@ -12,7 +12,9 @@ namespace Low
 		CommandPool(const QueueFamilyIndices& queueIndices);
 		~CommandPool();
 
-		std::vector<Ref<CommandBuffer>> AllocateCommandBuffers(uint32_t count);
+		std::vector<Ref<CommandBuffer>> AllocateCommandBuffers(uint32_t count, VkCommandBufferLevel level = VK_COMMAND_BUFFER_LEVEL_PRIMARY);
+		// Resets every buffer allocated from the pool at once
+		void Reset();
 
 		inline operator VkCommandPool() { return m_Handle; }
 
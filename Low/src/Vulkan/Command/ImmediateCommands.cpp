@@ -2,34 +2,145 @@
 #include <Structures/Buffer.h>
 #include <Vulkan/Queue.h>
 #include <Vulkan/VulkanCore.h>
+#include <Vulkan/Command/TransferCommands.h>
+#include <Rendering/StagingRing.h>
+#include <Synchronization/Synchronization.h>
+
+#include <mutex>
+#include <thread>
 
 namespace Low
 {
 	struct OTCState
 	{
-		VkCommandPool CommandPool;
+		// Not shared with the frames, which are recorded by the render thread
+		VkCommandPool CommandPool = VK_NULL_HANDLE;
+		// Held while a command buffer of the pool is allocated, recorded, submitted or freed: the application thread and the
+		// render thread can both use immediate commands
+		std::mutex Mutex;
+
+		// Thread that opened the batch, the others keep submitting their operations on their own
+		std::thread::id BatchThread;
+		// Nested BeginBatch calls, the batch is only submitted by the outermost EndBatch
+		uint32_t BatchDepth = 0;
+		// Graphics command buffer of the open batch, only allocated once an operation needs the graphics queue: with a
+		// transfer queue, batches of uploads don't touch it at all
+		VkCommandBuffer Batch = VK_NULL_HANDLE;
+		// Submitted batches and the frame timeline value they signal, freed once it's reached
+		std::deque<std::pair<VkCommandBuffer, uint64_t>> InFlight;
 	} s_OTCState;
 
-	void ImmediateCommands::CopyBuffer(VkBuffer dst, VkBuffer src, size_t size)
+	static VkCommandBuffer Allocate()
+	{
+		VkCommandBufferAllocateInfo allocInfo{};
+		VkCommandBuffer commandBuffer;
+
+		allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+		allocInfo.commandPool = s_OTCState.CommandPool;
+		allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+		allocInfo.commandBufferCount = 1;
+
+		if (vkAllocateCommandBuffers(VulkanCore::Device(), &allocInfo, &commandBuffer) != VK_SUCCESS) {
+			throw std::runtime_error("Couldn't allocate command buffers");
+		}
+		VkCommandBufferBeginInfo beginInfo = {};
+		beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+		beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+		if (vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS)
+			throw std::runtime_error("Couldn't begin cmd buffer");
+
+		return commandBuffer;
+	}
+
+	static void SubmitAndWait(VkCommandBuffer cmdBuffer)
+	{
+		vkEndCommandBuffer(cmdBuffer);
+
+		uint64_t value = VulkanCore::GraphicsQueue()->Submit(cmdBuffer);
+		// With a transfer queue the staging ring only feeds TransferCommands. During batches, the ring is only read by the batch
+		if (!TransferCommands::Available() && s_OTCState.BatchDepth == 0)
+			StagingRing::Submitted(value, Synchronization::FrameTimeline());
+		Synchronization::FrameTimeline()->Wait(value);
+
+		vkFreeCommandBuffers(VulkanCore::Device(), s_OTCState.CommandPool, 1, &cmdBuffer);
+	}
+
+	// Called with the mutex held. Operations go to the open batch of the thread, or to a command buffer of their own that's
+	// submitted and waited for right away
+	static VkCommandBuffer Record()
+	{
+		if (s_OTCState.BatchDepth == 0 || s_OTCState.BatchThread != std::this_thread::get_id())
+			return Allocate();
+
+		if (s_OTCState.Batch == VK_NULL_HANDLE)
+		{
+			Ref<Timeline> timeline = Synchronization::FrameTimeline();
+			while (!s_OTCState.InFlight.empty() && timeline->IsComplete(s_OTCState.InFlight.front().second))
+			{
+				vkFreeCommandBuffers(VulkanCore::Device(), s_OTCState.CommandPool, 1, &s_OTCState.InFlight.front().first);
+				s_OTCState.InFlight.pop_front();
+			}
+			s_OTCState.Batch = Allocate();
+		}
+		return s_OTCState.Batch;
+	}
+
+	static void Finish(VkCommandBuffer commandBuffer)
 	{
-		VkCommandBuffer commandBuffer = Begin();
+		if (commandBuffer != s_OTCState.Batch)
+			SubmitAndWait(commandBuffer);
+	}
+
+	// Returns 0 if the batch didn't need the graphics queue
+	static uint64_t SubmitBatch()
+	{
+		// The uploads on the transfer queue are acquired by the next frame, nothing to wait for here
+		TransferCommands::EndBatch();
+
+		VkCommandBuffer commandBuffer = s_OTCState.Batch;
+		if (commandBuffer == VK_NULL_HANDLE)
+			return 0;
+		s_OTCState.Batch = VK_NULL_HANDLE;
+
+		// Buffer copies aren't followed by barriers of their own: make all the writes visible to the commands submitted later
+		VkMemoryBarrier barrier = {};
+		barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+		barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		barrier.dstAccessMask = VK_ACCESS_MEMORY_READ_BIT;
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+		vkEndCommandBuffer(commandBuffer);
+
+		uint64_t value = VulkanCore::GraphicsQueue()->Submit(commandBuffer);
+		if (!TransferCommands::Available())
+			StagingRing::Submitted(value, Synchronization::FrameTimeline());
+		s_OTCState.InFlight.push_back({ commandBuffer, value });
+
+		return value;
+	}
+
+	void ImmediateCommands::CopyBuffer(VkBuffer dst, VkBuffer src, size_t size, VkDeviceSize srcOffset)
+	{
+		std::lock_guard<std::mutex> lock(s_OTCState.Mutex);
+		VkCommandBuffer commandBuffer = Record();
 		{
 			VkBufferCopy copyRegion;
-			copyRegion.srcOffset = 0;
+			copyRegion.srcOffset = srcOffset;
 			copyRegion.dstOffset = 0;
 			copyRegion.size = size;
 			vkCmdCopyBuffer(commandBuffer, src, dst, 1, &copyRegion);
 		}
-		End(commandBuffer);
+		Finish(commandBuffer);
 	}
 
-	void ImmediateCommands::CopyBufferToImage(VkImage dst, VkBuffer src, uint32_t width, uint32_t height)
+	void ImmediateCommands::CopyBufferToImage(VkImage dst, VkBuffer src, uint32_t width, uint32_t height, VkDeviceSize srcOffset)
 	{
-		VkCommandBuffer cmdBuf = Begin();
+		std::lock_guard<std::mutex> lock(s_OTCState.Mutex);
+		VkCommandBuffer cmdBuf = Record();
 		{
 			VkBufferImageCopy reg = {};
 
-			reg.bufferOffset = 0;
+			reg.bufferOffset = srcOffset;
 			reg.bufferRowLength = 0;
 			reg.bufferImageHeight = 0;
 
@@ -43,12 +154,13 @@ namespace Low
 
 			vkCmdCopyBufferToImage(cmdBuf, src, dst, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &reg);
 		}
-		End(cmdBuf);
+		Finish(cmdBuf);
 	}
 
 	void ImmediateCommands::TransitionImageLayout(VkImage image, VkFormat format, VkImageLayout oldLayout, VkImageLayout newLayout)
 	{
-		VkCommandBuffer cmdBuf = Begin();
+		std::lock_guard<std::mutex> lock(s_OTCState.Mutex);
+		VkCommandBuffer cmdBuf = Record();
 		{
 			VkImageMemoryBarrier barrier = {};
 			barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
@@ -107,49 +219,78 @@ namespace Low
 			vkCmdPipelineBarrier(cmdBuf, sourceStage, destinationStage, 0, 0, nullptr, 0, nullptr, 1, &barrier);
 
 		}
-		End(cmdBuf);
+		Finish(cmdBuf);
 	}
 
 	VkCommandBuffer ImmediateCommands::Begin()
 	{
-		VkCommandBufferAllocateInfo allocInfo{};
-		VkCommandBuffer commandBuffer;
+		// Released by End
+		s_OTCState.Mutex.lock();
+		return Allocate();
+	}
 
-		allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-		allocInfo.commandPool = s_OTCState.CommandPool;
-		allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-		allocInfo.commandBufferCount = 1;
+	void ImmediateCommands::End(VkCommandBuffer cmdBuffer)
+	{
+		SubmitAndWait(cmdBuffer);
+		s_OTCState.Mutex.unlock();
+	}
 
-		if (vkAllocateCommandBuffers(VulkanCore::Device(), &allocInfo, &commandBuffer) != VK_SUCCESS) {
-			throw std::runtime_error("Couldn't allocate command buffers");
-		}
-		VkCommandBufferBeginInfo beginInfo = {};
-		beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-		beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+	void ImmediateCommands::BeginBatch()
+	{
+		std::lock_guard<std::mutex> lock(s_OTCState.Mutex);
+		if (s_OTCState.BatchDepth > 0 && s_OTCState.BatchThread != std::this_thread::get_id())
+			throw std::runtime_error("An immediate commands batch is already open on another thread");
 
-		if (vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS)
-			throw std::runtime_error("Couldn't begin cmd buffer");
+		if (s_OTCState.BatchDepth++ > 0)
+			return;
 
-		return commandBuffer;
+		s_OTCState.BatchThread = std::this_thread::get_id();
+		TransferCommands::BeginBatch();
 	}
 
-	void ImmediateCommands::End(VkCommandBuffer cmdBuffer)
+	uint64_t ImmediateCommands::EndBatch()
 	{
-		vkEndCommandBuffer(cmdBuffer);
+		std::lock_guard<std::mutex> lock(s_OTCState.Mutex);
+		if (s_OTCState.BatchDepth == 0 || s_OTCState.BatchThread != std::this_thread::get_id())
+			return 0;
+		if (--s_OTCState.BatchDepth > 0)
+			return 0;
+		return SubmitBatch();
+	}
 
-		VkSubmitInfo submit = {};
-		submit.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-		submit.commandBufferCount = 1;
-		submit.pCommandBuffers = &cmdBuffer;
+	uint64_t ImmediateCommands::Flush()
+	{
+		std::lock_guard<std::mutex> lock(s_OTCState.Mutex);
+		if (s_OTCState.BatchDepth == 0 || s_OTCState.BatchThread != std::this_thread::get_id())
+			return 0;
 
-		vkQueueSubmit(*VulkanCore::GraphicsQueue(), 1, &submit, VK_NULL_HANDLE);
-		vkQueueWaitIdle(*VulkanCore::GraphicsQueue());
+		// The graphics command buffer is allocated again by the next operation that needs it
+		uint64_t value = SubmitBatch();
+		TransferCommands::BeginBatch();
+		return value;
+	}
 
-		vkFreeCommandBuffers(VulkanCore::Device(), s_OTCState.CommandPool, 1, &cmdBuffer);
+	void ImmediateCommands::Init()
+	{
+		VkCommandPoolCreateInfo poolInfo = {};
+		poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+		poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+		poolInfo.queueFamilyIndex = VulkanCore::GraphicsFamily();
+
+		if (vkCreateCommandPool(VulkanCore::Device(), &poolInfo, nullptr, &s_OTCState.CommandPool) != VK_SUCCESS)
+			throw std::runtime_error("Couldn't create immediate commands pool");
 	}
 
-	void ImmediateCommands::Init(VkCommandPool pool)
+	void ImmediateCommands::Shutdown()
 	{
-		s_OTCState.CommandPool = pool;
+		if (s_OTCState.CommandPool == VK_NULL_HANDLE)
+			return;
+
+		// Destroying the pool frees its buffers
+		vkDestroyCommandPool(VulkanCore::Device(), s_OTCState.CommandPool, nullptr);
+		s_OTCState.CommandPool = VK_NULL_HANDLE;
+		s_OTCState.Batch = VK_NULL_HANDLE;
+		s_OTCState.BatchDepth = 0;
+		s_OTCState.InFlight.clear();
 	}
-}
\ No newline at end of file
+}
@@ -4,17 +4,36 @@ namespace Low
 {
 	class Buffer;
 
+	// Commands recorded and submitted to the graphics queue outside of frames. Every operation is submitted and waited for on
+	// its own, unless a batch is open: then they're all recorded into one command buffer and submitted together. Uses a command
+	// pool of its own and can be called from any thread, batches belong to the thread that opened them
 	class ImmediateCommands
 	{
 	public:
-		static void Init(VkCommandPool pool);
+		static void Init();
+		static void Shutdown();
 
-		static void CopyBuffer(VkBuffer dst, VkBuffer src, size_t size);
-		static void CopyBufferToImage(VkImage dst, VkBuffer src, uint32_t imgWidth, uint32_t imgHeight);
+		static void CopyBuffer(VkBuffer dst, VkBuffer src, size_t size, VkDeviceSize srcOffset = 0);
+		static void CopyBufferToImage(VkImage dst, VkBuffer src, uint32_t imgWidth, uint32_t imgHeight, VkDeviceSize srcOffset = 0);
 
 		static void TransitionImageLayout(VkImage image, VkFormat format, VkImageLayout oldLayout, VkImageLayout newLayout);
 
+		// Until EndBatch, the operations above and the TransferCommands uploads of the thread are recorded instead of submitted.
+		// The resources they use have to live until the batch is executed. Batches can be nested, only the outermost one is
+		// submitted. Only one thread can have a batch open at a time
+		static void BeginBatch();
+		// Submits the batch and returns the frame timeline value signaled once it's executed: wait for it before reading the
+		// results on the CPU. Commands submitted to the graphics queue afterwards see the results without waiting, the uploads
+		// on the transfer queue are acquired by the next frame. Returns 0 when closing a nested batch, or if nothing in the
+		// batch needed the graphics queue
+		static uint64_t EndBatch();
+		// Submits what's been recorded so far and keeps batching, returns 0 outside of batches
+		static uint64_t Flush();
+
+		// Standalone command buffer, even during batches. Other threads' immediate commands wait until End, don't call the
+		// operations above in between
 		static VkCommandBuffer Begin();
+		// Waits for the commands to be executed, the staging ring space they read is reclaimed afterwards
 		static void End(VkCommandBuffer cmd);
 	};
 }
\ No newline at end of file
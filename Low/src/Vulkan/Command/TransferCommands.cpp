@@ -0,0 +1,237 @@
+#include <Vulkan/Command/TransferCommands.h>
+#include <Vulkan/Queue.h>
+#include <Vulkan/VulkanCore.h>
+#include <Rendering/StagingRing.h>
+#include <Synchronization/Synchronization.h>
+
+#include <mutex>
+
+namespace Low
+{
+	struct TransferState
+	{
+		VkCommandPool CommandPool = VK_NULL_HANDLE;
+		// Submitted command buffers and the transfer timeline value they signal, freed once it's reached
+		std::deque<std::pair<VkCommandBuffer, uint64_t>> InFlight;
+
+		// Open batch, VK_NULL_HANDLE outside of BeginBatch / EndBatch
+		VkCommandBuffer Batch = VK_NULL_HANDLE;
+		// Release halves of the ownership transfers recorded since the last submission, all recorded right before it
+		std::vector<VkBufferMemoryBarrier> BufferReleases;
+		std::vector<VkImageMemoryBarrier> ImageReleases;
+
+		// Acquire halves of the ownership transfers, handed over to the thread drawing the frames
+		std::mutex Mutex;
+		std::vector<VkBufferMemoryBarrier> BufferAcquires;
+		std::vector<VkImageMemoryBarrier> ImageAcquires;
+		uint64_t AcquireValue = 0;
+	} s_TransferState;
+
+	static VkCommandBuffer Begin()
+	{
+		Ref<Timeline> timeline = Synchronization::TransferTimeline();
+		while (!s_TransferState.InFlight.empty() && timeline->IsComplete(s_TransferState.InFlight.front().second))
+		{
+			vkFreeCommandBuffers(VulkanCore::Device(), s_TransferState.CommandPool, 1, &s_TransferState.InFlight.front().first);
+			s_TransferState.InFlight.pop_front();
+		}
+
+		VkCommandBufferAllocateInfo allocInfo = {};
+		allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+		allocInfo.commandPool = s_TransferState.CommandPool;
+		allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+		allocInfo.commandBufferCount = 1;
+
+		VkCommandBuffer commandBuffer;
+		if (vkAllocateCommandBuffers(VulkanCore::Device(), &allocInfo, &commandBuffer) != VK_SUCCESS)
+			throw std::runtime_error("Couldn't allocate transfer command buffer");
+
+		VkCommandBufferBeginInfo beginInfo = {};
+		beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+		beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+		if (vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS)
+			throw std::runtime_error("Couldn't begin transfer command buffer");
+
+		return commandBuffer;
+	}
+
+	static uint64_t Submit(VkCommandBuffer commandBuffer)
+	{
+		TransferState& state = s_TransferState;
+
+		// Release everything the submission wrote to the graphics family at once
+		if (!state.BufferReleases.empty() || !state.ImageReleases.empty())
+		{
+			vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, 0, nullptr,
+				state.BufferReleases.size(), state.BufferReleases.data(), state.ImageReleases.size(), state.ImageReleases.data());
+		}
+		vkEndCommandBuffer(commandBuffer);
+
+		uint64_t value = VulkanCore::TransferQueue()->Submit(commandBuffer);
+		StagingRing::Submitted(value, Synchronization::TransferTimeline());
+		state.InFlight.push_back({ commandBuffer, value });
+
+		// The acquires only differ by their access masks, and are only handed over once the releases are submitted
+		std::lock_guard<std::mutex> lock(state.Mutex);
+		for (VkBufferMemoryBarrier barrier : state.BufferReleases)
+		{
+			barrier.srcAccessMask = 0;
+			barrier.dstAccessMask = VK_ACCESS_MEMORY_READ_BIT;
+			state.BufferAcquires.push_back(barrier);
+		}
+		for (VkImageMemoryBarrier barrier : state.ImageReleases)
+		{
+			barrier.srcAccessMask = 0;
+			barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+			state.ImageAcquires.push_back(barrier);
+		}
+		state.AcquireValue = value;
+
+		state.BufferReleases.clear();
+		state.ImageReleases.clear();
+		return value;
+	}
+
+	// Copies go to the open batch, or to a command buffer of their own that's submitted right away
+	static VkCommandBuffer Record()
+	{
+		if (s_TransferState.Batch != VK_NULL_HANDLE)
+			return s_TransferState.Batch;
+		return Begin();
+	}
+
+	static void Finish(VkCommandBuffer commandBuffer)
+	{
+		if (commandBuffer != s_TransferState.Batch)
+			Submit(commandBuffer);
+	}
+
+	void TransferCommands::Init()
+	{
+		if (!Available())
+			return;
+
+		VkCommandPoolCreateInfo poolInfo = {};
+		poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+		poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+		poolInfo.queueFamilyIndex = VulkanCore::TransferFamily();
+
+		if (vkCreateCommandPool(VulkanCore::Device(), &poolInfo, nullptr, &s_TransferState.CommandPool) != VK_SUCCESS)
+			throw std::runtime_error("Couldn't create transfer command pool");
+	}
+
+	void TransferCommands::Shutdown()
+	{
+		if (s_TransferState.CommandPool == VK_NULL_HANDLE)
+			return;
+
+		// Destroying the pool frees its buffers
+		vkDestroyCommandPool(VulkanCore::Device(), s_TransferState.CommandPool, nullptr);
+		s_TransferState.CommandPool = VK_NULL_HANDLE;
+		s_TransferState.InFlight.clear();
+		s_TransferState.Batch = VK_NULL_HANDLE;
+		s_TransferState.BufferReleases.clear();
+		s_TransferState.ImageReleases.clear();
+		s_TransferState.BufferAcquires.clear();
+		s_TransferState.ImageAcquires.clear();
+	}
+
+	bool TransferCommands::Available()
+	{
+		return VulkanCore::TransferQueue() != nullptr;
+	}
+
+	void TransferCommands::CopyBuffer(VkBuffer dst, VkBuffer src, size_t size, VkDeviceSize srcOffset)
+	{
+		VkCommandBuffer commandBuffer = Record();
+
+		VkBufferCopy region = {};
+		region.srcOffset = srcOffset;
+		region.dstOffset = 0;
+		region.size = size;
+		vkCmdCopyBuffer(commandBuffer, src, dst, 1, &region);
+
+		// Release to the graphics family
+		VkBufferMemoryBarrier barrier = {};
+		barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+		barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		barrier.dstAccessMask = 0;
+		barrier.srcQueueFamilyIndex = VulkanCore::TransferFamily();
+		barrier.dstQueueFamilyIndex = VulkanCore::GraphicsFamily();
+		barrier.buffer = dst;
+		barrier.offset = 0;
+		barrier.size = VK_WHOLE_SIZE;
+		s_TransferState.BufferReleases.push_back(barrier);
+
+		Finish(commandBuffer);
+	}
+
+	void TransferCommands::CopyBufferToImage(VkImage dst, VkBuffer src, uint32_t width, uint32_t height, VkDeviceSize srcOffset)
+	{
+		VkCommandBuffer commandBuffer = Record();
+
+		VkImageMemoryBarrier barrier = {};
+		barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+		barrier.srcAccessMask = 0;
+		barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+		barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+		barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.image = dst;
+		barrier.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 };
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+		VkBufferImageCopy region = {};
+		region.bufferOffset = srcOffset;
+		region.imageSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1 };
+		region.imageOffset = { 0, 0, 0 };
+		region.imageExtent = { width, height, 1 };
+		vkCmdCopyBufferToImage(commandBuffer, src, dst, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+
+		// Release to the graphics family, the layout change happens in between the release and the acquire
+		barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		barrier.dstAccessMask = 0;
+		barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+		barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+		barrier.srcQueueFamilyIndex = VulkanCore::TransferFamily();
+		barrier.dstQueueFamilyIndex = VulkanCore::GraphicsFamily();
+		s_TransferState.ImageReleases.push_back(barrier);
+
+		Finish(commandBuffer);
+	}
+
+	void TransferCommands::BeginBatch()
+	{
+		if (!Available() || s_TransferState.Batch != VK_NULL_HANDLE)
+			return;
+		s_TransferState.Batch = Begin();
+	}
+
+	uint64_t TransferCommands::EndBatch()
+	{
+		VkCommandBuffer commandBuffer = s_TransferState.Batch;
+		if (commandBuffer == VK_NULL_HANDLE)
+			return 0;
+
+		s_TransferState.Batch = VK_NULL_HANDLE;
+		return Submit(commandBuffer);
+	}
+
+	uint64_t TransferCommands::Acquire(VkCommandBuffer commandBuffer)
+	{
+		std::lock_guard<std::mutex> lock(s_TransferState.Mutex);
+		if (s_TransferState.BufferAcquires.empty() && s_TransferState.ImageAcquires.empty())
+			return 0;
+
+		// The frame waits on the transfer timeline for all commands, which covers the source stage of the acquire
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, 0, 0, nullptr,
+			s_TransferState.BufferAcquires.size(), s_TransferState.BufferAcquires.data(),
+			s_TransferState.ImageAcquires.size(), s_TransferState.ImageAcquires.data());
+
+		s_TransferState.BufferAcquires.clear();
+		s_TransferState.ImageAcquires.clear();
+		return s_TransferState.AcquireValue;
+	}
+}
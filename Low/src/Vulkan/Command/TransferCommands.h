@@ -0,0 +1,30 @@
+#pragma once
+
+namespace Low
+{
+	// Uploads on the transfer only queue, when the device has one, so that they run next to rendering instead of stalling it.
+	// The copies release the resources to the graphics family and signal the transfer timeline, the next frame acquires them
+	// after waiting on it. Calls return once the copy is submitted, or once it's recorded during batches
+	class TransferCommands
+	{
+	public:
+		static void Init();
+		static void Shutdown();
+
+		// False without a transfer queue: uploads go through ImmediateCommands on the graphics queue
+		static bool Available();
+
+		static void CopyBuffer(VkBuffer dst, VkBuffer src, size_t size, VkDeviceSize srcOffset = 0);
+		// The image ends up in VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL once acquired
+		static void CopyBufferToImage(VkImage dst, VkBuffer src, uint32_t width, uint32_t height, VkDeviceSize srcOffset = 0);
+
+		// Opened and submitted by ImmediateCommands::BeginBatch / EndBatch: the copies in between share one submission and
+		// one set of release barriers. EndBatch returns the transfer timeline value signaled by it, 0 if no batch was open
+		static void BeginBatch();
+		static uint64_t EndBatch();
+
+		// Graphics side, recorded at the start of a frame: acquires the resources uploaded since the last call. Returns the
+		// transfer timeline value the frame has to wait for, 0 if nothing was acquired
+		static uint64_t Acquire(VkCommandBuffer commandBuffer);
+	};
+}
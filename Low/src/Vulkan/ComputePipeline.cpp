@@ -0,0 +1,53 @@
+#include <Vulkan/ComputePipeline.h>
+#include <Vulkan/Descriptor/DescriptorSetLayout.h>
+#include <Vulkan/VulkanCore.h>
+
+#include <Resources/Shader.h>
+
+namespace Low
+{
+	ComputePipeline::ComputePipeline(Ref<Shader> shader, const DescriptorSetLayout& descLayout, uint32_t pushConstantsSize)
+	{
+		VkDescriptorSetLayout layout = descLayout;
+
+		VkPushConstantRange pushConsts = {};
+		pushConsts.offset = 0;
+		pushConsts.size = pushConstantsSize;
+		pushConsts.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+
+		VkPipelineLayoutCreateInfo pipelineLayoutInfo = {};
+		pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+		pipelineLayoutInfo.pushConstantRangeCount = pushConstantsSize > 0 ? 1 : 0;
+		pipelineLayoutInfo.pPushConstantRanges = &pushConsts;
+		pipelineLayoutInfo.setLayoutCount = 1;
+		pipelineLayoutInfo.pSetLayouts = &layout;
+
+		if (vkCreatePipelineLayout(VulkanCore::Device(), &pipelineLayoutInfo, nullptr, &m_Layout) != VK_SUCCESS)
+			throw std::runtime_error("Couldn't create compute pipeline layout");
+
+		VkComputePipelineCreateInfo pipelineCreateInfo = {};
+		pipelineCreateInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+		pipelineCreateInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+		pipelineCreateInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+		pipelineCreateInfo.stage.module = shader->GetComputeModule();
+		pipelineCreateInfo.stage.pName = "main";
+		pipelineCreateInfo.layout = m_Layout;
+		pipelineCreateInfo.basePipelineHandle = VK_NULL_HANDLE;
+		pipelineCreateInfo.basePipelineIndex = -1;
+
+		if (vkCreateComputePipelines(VulkanCore::Device(), VK_NULL_HANDLE, 1, &pipelineCreateInfo, nullptr, &m_Handle) != VK_SUCCESS)
+			throw std::runtime_error("Couldn't create compute pipeline");
+	}
+
+	ComputePipeline::~ComputePipeline()
+	{
+		vkDeviceWaitIdle(VulkanCore::Device());
+		vkDestroyPipelineLayout(VulkanCore::Device(), m_Layout, nullptr);
+		vkDestroyPipeline(VulkanCore::Device(), m_Handle, nullptr);
+	}
+
+	void ComputePipeline::Bind(VkCommandBuffer commandBuffer)
+	{
+		vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_Handle);
+	}
+}
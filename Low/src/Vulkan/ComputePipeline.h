@@ -0,0 +1,23 @@
+#pragma once
+
+namespace Low
+{
+	class Shader;
+	class DescriptorSetLayout;
+
+	class ComputePipeline
+	{
+	public:
+		ComputePipeline(Ref<Shader> shader, const DescriptorSetLayout& descLayout, uint32_t pushConstantsSize);
+		~ComputePipeline();
+
+		void Bind(VkCommandBuffer commandBuffer);
+
+		inline operator VkPipeline() { return m_Handle; }
+		inline VkPipelineLayout Layout() { return m_Layout; }
+
+	private:
+		VkPipeline m_Handle;
+		VkPipelineLayout m_Layout;
+	};
+}
@@ -5,18 +5,33 @@ namespace Low
 {
 	DescriptorPool::DescriptorPool(uint32_t count)
 	{
-		std::array<VkDescriptorPoolSize, 2> poolSizes = {};
+		// Every frame uses a geometry, a lighting, a culling and a light binning set. The lighting one samples the G-buffer and
+		// reads the lights, the compute ones are made of storage buffers, uniforms and the depth pyramid. On top of that, the
+		// depth pyramid has up to 16 reduction sets per frame, each reading a level and writing the next one
+		std::array<VkDescriptorPoolSize, 6> poolSizes = {};
 		poolSizes[0].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-		poolSizes[0].descriptorCount = count;
+		poolSizes[0].descriptorCount = count * 3;
 
 		poolSizes[1].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-		poolSizes[1].descriptorCount = count;
+		poolSizes[1].descriptorCount = count * 23;
+
+		poolSizes[2].type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		poolSizes[2].descriptorCount = count * 14;
+
+		poolSizes[3].type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC;
+		poolSizes[3].descriptorCount = count;
+
+		poolSizes[4].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+		poolSizes[4].descriptorCount = count * 2;
+
+		poolSizes[5].type = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+		poolSizes[5].descriptorCount = count * 16;
 
 		VkDescriptorPoolCreateInfo poolInfo = {};
 		poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
 		poolInfo.poolSizeCount = poolSizes.size();
 		poolInfo.pPoolSizes = poolSizes.data();
-		poolInfo.maxSets = count;
+		poolInfo.maxSets = count * 20;
 
 		if (vkCreateDescriptorPool(VulkanCore::Device(), &poolInfo, nullptr, &m_Handle) != VK_SUCCESS)
 			throw std::runtime_error("Couldn't create descriptor pool");
@@ -10,7 +10,8 @@
 
 namespace Low
 {
-	GraphicsPipeline::GraphicsPipeline(Ref<Shader> shader, const DescriptorSetLayout& descLayout, Ref<RenderPass> renderPass, const glm::vec2& size)
+	GraphicsPipeline::GraphicsPipeline(Ref<Shader> shader, const DescriptorSetLayout& descLayout, Ref<RenderPass> renderPass, const glm::vec2& size,
+		const GraphicsPipelineConfig& config)
 	{
 		VkPipelineShaderStageCreateInfo vertShaderStageInfo = {};
 		vertShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
@@ -25,6 +26,7 @@ namespace Low
 		fragShaderStageInfo.pName = "main";
 
 		VkPipelineShaderStageCreateInfo shaderStages[] = { vertShaderStageInfo, fragShaderStageInfo };
+		bool depthOnly = shader->GetFragmentModule() == VK_NULL_HANDLE;
 		std::vector<VkDynamicState> dynamicStates = { VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR };
 
 		VkPipelineDynamicStateCreateInfo dynamicState = {};
@@ -33,14 +35,23 @@ namespace Low
 		dynamicState.pDynamicStates = dynamicStates.data();
 
 		VkPipelineVertexInputStateCreateInfo vertexInputInfo = {};
-		auto bindingDesc = Vertex::GetVertexBindingDescription();
+		// Per-vertex data in binding 0, per-instance data in binding 1
+		std::array<VkVertexInputBindingDescription, 2> bindingDesc = { Vertex::GetVertexBindingDescription(), InstanceData::GetInstanceBindingDescription() };
 		auto attributeDesc = Vertex::GetVertexAttributeDescriptions();
+		// Same stride, only the position attribute is fetched
+		if (config.PositionOnly)
+			attributeDesc.resize(1);
+		auto instanceAttributeDesc = InstanceData::GetInstanceAttributeDescriptions();
+		attributeDesc.insert(attributeDesc.end(), instanceAttributeDesc.begin(), instanceAttributeDesc.end());
 
 		vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
-		vertexInputInfo.vertexBindingDescriptionCount = 1;
-		vertexInputInfo.pVertexBindingDescriptions = &bindingDesc;
-		vertexInputInfo.vertexAttributeDescriptionCount = attributeDesc.size();
-		vertexInputInfo.pVertexAttributeDescriptions = attributeDesc.data();
+		if (config.VertexInput)
+		{
+			vertexInputInfo.vertexBindingDescriptionCount = bindingDesc.size();
+			vertexInputInfo.pVertexBindingDescriptions = bindingDesc.data();
+			vertexInputInfo.vertexAttributeDescriptionCount = attributeDesc.size();
+			vertexInputInfo.pVertexAttributeDescriptions = attributeDesc.data();
+		}
 
 		VkPipelineInputAssemblyStateCreateInfo inputAssembly = {};
 		inputAssembly.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
@@ -68,9 +79,9 @@ namespace Low
 
 		VkPipelineDepthStencilStateCreateInfo depthState = {};
 		depthState.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
-		depthState.depthTestEnable = VK_TRUE;
-		depthState.depthWriteEnable = VK_TRUE;
-		depthState.depthCompareOp = VK_COMPARE_OP_LESS;
+		depthState.depthTestEnable = config.DepthTest;
+		depthState.depthWriteEnable = config.DepthTest && config.DepthWrite;
+		depthState.depthCompareOp = config.DepthCompareOp;
 		depthState.stencilTestEnable = VK_FALSE;
 		depthState.front = {};
 		depthState.back = {};
@@ -81,7 +92,7 @@ namespace Low
 		rasterizer.rasterizerDiscardEnable = VK_FALSE;
 		rasterizer.polygonMode = VK_POLYGON_MODE_FILL;
 		rasterizer.lineWidth = 1.0f;
-		rasterizer.cullMode = VK_CULL_MODE_BACK_BIT;
+		rasterizer.cullMode = config.CullMode;
 		rasterizer.frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE;
 		// [SHADOWMAPPING]
 		rasterizer.depthBiasEnable = VK_FALSE;
@@ -100,7 +111,7 @@ namespace Low
 		multisampling.alphaToOneEnable = VK_FALSE;
 
 		VkPipelineColorBlendAttachmentState colorBlendAttachment{};
-		colorBlendAttachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+		colorBlendAttachment.colorWriteMask = depthOnly ? 0 : VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
 		colorBlendAttachment.blendEnable = VK_FALSE;
 		colorBlendAttachment.srcColorBlendFactor = VK_BLEND_FACTOR_ONE;
 		colorBlendAttachment.dstColorBlendFactor = VK_BLEND_FACTOR_ZERO;
@@ -108,13 +119,14 @@ namespace Low
 		colorBlendAttachment.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
 		colorBlendAttachment.dstAlphaBlendFactor = VK_BLEND_FACTOR_ZERO;
 		colorBlendAttachment.alphaBlendOp = VK_BLEND_OP_ADD;
+		std::vector<VkPipelineColorBlendAttachmentState> colorBlendAttachments(config.ColorAttachments, colorBlendAttachment);
 
 		VkPipelineColorBlendStateCreateInfo colorBlending{};
 		colorBlending.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
 		colorBlending.logicOpEnable = VK_FALSE;
 		colorBlending.logicOp = VK_LOGIC_OP_COPY;
-		colorBlending.attachmentCount = 1;
-		colorBlending.pAttachments = &colorBlendAttachment;
+		colorBlending.attachmentCount = colorBlendAttachments.size();
+		colorBlending.pAttachments = colorBlendAttachments.data();
 		colorBlending.blendConstants[0] = 0.0f;
 		colorBlending.blendConstants[1] = 0.0f;
 		colorBlending.blendConstants[2] = 0.0f;
@@ -126,7 +138,7 @@ namespace Low
 		// Push constants
 		VkPushConstantRange pushConsts;
 		pushConsts.offset = 0;
-		pushConsts.size = sizeof(PushConsts);
+		pushConsts.size = config.PushConstantSize;
 		pushConsts.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
 
 		pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
@@ -140,7 +152,7 @@ namespace Low
 
 		VkGraphicsPipelineCreateInfo pipelineCreateInfo = {};
 		pipelineCreateInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
-		pipelineCreateInfo.stageCount = 2;
+		pipelineCreateInfo.stageCount = depthOnly ? 1 : 2;
 		pipelineCreateInfo.pStages = shaderStages;
 
 		pipelineCreateInfo.pVertexInputState = &vertexInputInfo;
@@ -154,6 +166,16 @@ namespace Low
 		pipelineCreateInfo.layout = m_Layout;
 		pipelineCreateInfo.renderPass = *renderPass;
 		pipelineCreateInfo.subpass = 0;
+
+		// Without a render pass object the attachments are only known by their formats, so the pipeline stays valid whatever
+		// views it's used with
+		VkPipelineRenderingCreateInfo renderingInfo = {};
+		renderingInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_RENDERING_CREATE_INFO;
+		renderingInfo.colorAttachmentCount = renderPass->ColorFormats().size();
+		renderingInfo.pColorAttachmentFormats = renderPass->ColorFormats().data();
+		renderingInfo.depthAttachmentFormat = renderPass->DepthFormat();
+		if (pipelineCreateInfo.renderPass == VK_NULL_HANDLE)
+			pipelineCreateInfo.pNext = &renderingInfo;
 		pipelineCreateInfo.basePipelineHandle = VK_NULL_HANDLE;
 		pipelineCreateInfo.basePipelineIndex = -1;
 
@@ -170,6 +192,11 @@ namespace Low
 
 	void GraphicsPipeline::Bind()
 	{
-		vkCmdBindPipeline(*State::CommandBuffer(), VK_PIPELINE_BIND_POINT_GRAPHICS, m_Handle);
+		Bind(*State::CommandBuffer());
+	}
+
+	void GraphicsPipeline::Bind(VkCommandBuffer commandBuffer)
+	{
+		vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_Handle);
 	}	
 }
\ No newline at end of file
@@ -6,21 +6,40 @@ namespace Low
 	class DescriptorSetLayout;
 	class RenderPass;
 
+	// Surface parameters of the G-buffer pass, shading needs the camera and happens in the lighting pass
 	struct PushConsts
 	{
-		glm::vec3 CameraPos;
 		float Metallic;
 		float Roughness;
 		float AO;
 	};
 
+	struct GraphicsPipelineConfig
+	{
+		// Must match the color attachments of the render pass
+		uint32_t ColorAttachments = 1;
+		// Fullscreen passes generate their vertices from gl_VertexIndex
+		bool VertexInput = true;
+		// Depth prepasses only read the position of the vertices
+		bool PositionOnly = false;
+		bool DepthTest = true;
+		bool DepthWrite = true;
+		VkCompareOp DepthCompareOp = VK_COMPARE_OP_LESS;
+		VkCullModeFlags CullMode = VK_CULL_MODE_BACK_BIT;
+		// Fragment stage only
+		uint32_t PushConstantSize = sizeof(PushConsts);
+	};
+
+	// Shaders without a fragment module make depth only pipelines: color writes are masked off
 	class GraphicsPipeline
 	{
 	public:
-		GraphicsPipeline(Ref<Shader> shader, const DescriptorSetLayout& descLayout, Ref<RenderPass> renderPass, const glm::vec2& size);
+		GraphicsPipeline(Ref<Shader> shader, const DescriptorSetLayout& descLayout, Ref<RenderPass> renderPass, const glm::vec2& size,
+			const GraphicsPipelineConfig& config = {});
 		~GraphicsPipeline();
 
 		void Bind();
+		void Bind(VkCommandBuffer commandBuffer);
 
 		inline operator VkPipeline() { return m_Handle; }
 		inline VkPipelineLayout Layout() { return m_Layout; }
@@ -4,33 +4,84 @@
 #include <Synchronization/Synchronization.h>
 #include <Core/State.h>
 
+#include <mutex>
+
 namespace Low
 {
-	void Queue::Submit(std::vector<Ref<CommandBuffer>> cmdBuffers)
+	// Submits can come from the render thread and from immediate commands on the application thread. Shared by all the
+	// queues, since graphics and present can be the same VkQueue, and held across Advance so timeline values reach the
+	// queue in order
+	static std::mutex s_SubmitMutex;
+
+	uint64_t Queue::Submit(std::vector<Ref<CommandBuffer>> cmdBuffers, bool presented, uint64_t transferValue)
 	{
 		std::vector<VkCommandBuffer> vkBuffers(cmdBuffers.size());
 		for (uint32_t i = 0; i < cmdBuffers.size(); i++)
 			vkBuffers[i] = *cmdBuffers[i];
 
-		assert(m_Type == QueueType::Graphics);
+		std::vector<QueueWait> waits;
+		std::vector<VkSemaphore> signalSems;
+		if (presented)
+		{
+			waits.push_back({ *Synchronization::GetSemaphore("ImageAvailable"), 0, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT });
+			signalSems.push_back(*Synchronization::GetSemaphore("RenderFinished"));
+		}
+		// Uploads are acquired at the start of the frame
+		if (transferValue > 0)
+			waits.push_back({ *Synchronization::TransferTimeline(), transferValue, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT });
 
-		VkSubmitInfo submitInfo = {};
-		VkPipelineStageFlags waitStages[] = { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT };
+		return Submit(vkBuffers, waits, signalSems);
+	}
 
-		std::vector<VkSemaphore> waitSems = { *Synchronization::GetSemaphore("ImageAvailable") };
-		std::vector<VkSemaphore> signalSems = { *Synchronization::GetSemaphore("RenderFinished") };
+	uint64_t Queue::Submit(VkCommandBuffer cmdBuffer)
+	{
+		return Submit({ cmdBuffer }, {}, {});
+	}
 
+	uint64_t Queue::Submit(const std::vector<VkCommandBuffer>& vkBuffers, const std::vector<QueueWait>& waits, std::vector<VkSemaphore> signalSems)
+	{
+		assert(m_Type == QueueType::Graphics || m_Type == QueueType::Transfer);
+
+		std::vector<VkSemaphore> waitSems(waits.size());
+		std::vector<uint64_t> waitValues(waits.size());
+		std::vector<VkPipelineStageFlags> waitStages(waits.size());
+		for (uint32_t i = 0; i < waits.size(); i++)
+		{
+			waitSems[i] = waits[i].Semaphore;
+			waitValues[i] = waits[i].Value;
+			waitStages[i] = waits[i].Stage;
+		}
+
+		// Binary semaphores ignore their value
+		Ref<Timeline> timeline = m_Type == QueueType::Transfer ? Synchronization::TransferTimeline() : Synchronization::FrameTimeline();
+		std::lock_guard<std::mutex> lock(s_SubmitMutex);
+		uint64_t value = timeline->Advance();
+		signalSems.push_back(*timeline);
+		std::vector<uint64_t> signalValues(signalSems.size(), 0);
+		signalValues.back() = value;
+
+		VkTimelineSemaphoreSubmitInfo timelineInfo = {};
+		timelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+		timelineInfo.waitSemaphoreValueCount = waitValues.size();
+		timelineInfo.pWaitSemaphoreValues = waitValues.data();
+		timelineInfo.signalSemaphoreValueCount = signalValues.size();
+		timelineInfo.pSignalSemaphoreValues = signalValues.data();
+
+		VkSubmitInfo submitInfo = {};
 		submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+		submitInfo.pNext = &timelineInfo;
 		submitInfo.waitSemaphoreCount = waitSems.size();
 		submitInfo.pWaitSemaphores = waitSems.data();
-		submitInfo.pWaitDstStageMask = waitStages;
+		submitInfo.pWaitDstStageMask = waitStages.data();
 		submitInfo.commandBufferCount = vkBuffers.size();
 		submitInfo.pCommandBuffers = vkBuffers.data();
 		submitInfo.signalSemaphoreCount = signalSems.size();
 		submitInfo.pSignalSemaphores = signalSems.data();
 
-		if (vkQueueSubmit(m_Handle, 1, &submitInfo, *Synchronization::GetFence("FrameInFlight")) != VK_SUCCESS)
-			throw std::runtime_error("Couldn't submit queue for rendering");
+		if (vkQueueSubmit(m_Handle, 1, &submitInfo, VK_NULL_HANDLE) != VK_SUCCESS)
+			throw std::runtime_error("Couldn't submit queue");
+
+		return value;
 	}
 
 	VkResult Queue::Present(Ref<Swapchain> swapchain)
@@ -50,6 +101,7 @@ namespace Low
 		presentInfo.pImageIndices = &currImage;
 		presentInfo.pResults = nullptr;
 
+		std::lock_guard<std::mutex> lock(s_SubmitMutex);
 		return vkQueuePresentKHR(m_Handle, &presentInfo);
 	}
 }
\ No newline at end of file
@@ -5,6 +5,14 @@ namespace Low
 	class CommandBuffer;
 	class Swapchain;
 
+	struct QueueWait
+	{
+		VkSemaphore Semaphore;
+		// Ignored by binary semaphores
+		uint64_t Value;
+		VkPipelineStageFlags Stage;
+	};
+
 	class Queue
 	{
 	public:
@@ -12,11 +20,20 @@ namespace Low
 
 		Queue(VkQueue handle, QueueType type) : m_Handle(handle), m_Type(type) {}
 
-		void Submit(std::vector<Ref<CommandBuffer>> buf);
+		// Offscreen frames don't wait for a swapchain image and don't signal the semaphore presentation waits on. The frame
+		// waits for the transfer timeline to reach transferValue, if not 0. Returns the value of the frame timeline signaled
+		// once the buffers have been executed
+		uint64_t Submit(std::vector<Ref<CommandBuffer>> buf, bool presented = true, uint64_t transferValue = 0);
+		// Work outside frames (uploads), only signals the timeline of the queue: the frame timeline for the graphics queue,
+		// the transfer timeline for the transfer queue
+		uint64_t Submit(VkCommandBuffer buf);
 		VkResult Present(Ref<Swapchain> swapchain);
 
 		inline operator VkQueue() { return m_Handle; }
 
+	private:
+		uint64_t Submit(const std::vector<VkCommandBuffer>& buffers, const std::vector<QueueWait>& waits, std::vector<VkSemaphore> signals);
+
 	private:
 		VkQueue m_Handle;
 		QueueType m_Type;
@@ -8,28 +8,52 @@
 
 namespace Low
 {
-	RenderPass::RenderPass(const std::vector<FramebufferAttachmentSpecs>& specs)
+	RenderPass::RenderPass(const std::vector<FramebufferAttachmentSpecs>& specs) : m_Specs(specs)
 	{
 		std::vector<VkAttachmentDescription> descs;
-		std::vector<VkAttachmentReference> refs;
+		std::vector<VkAttachmentReference> colorRefs;
+		VkAttachmentReference depthRef = {};
+		bool hasDepth = false;
 
 		for (uint32_t i = 0; i < specs.size(); i++)
 		{
 			descs.push_back(specs[i].Description);
-			refs.push_back(specs[i].Reference);
+
+			// References index the attachments of this pass, whatever the specs were numbered with
+			VkAttachmentReference ref = specs[i].Reference;
+			ref.attachment = i;
+
+			VkClearValue clear = {};
+			if (specs[i].Type == AttachmentType::Depth)
+			{
+				depthRef = ref;
+				hasDepth = true;
+				clear.depthStencil = { 1.0f, 0 };
+				m_DepthFormat = specs[i].Format;
+			}
+			else
+			{
+				colorRefs.push_back(ref);
+				clear.color = { 0.0f, 0.0f, 0.0f, 1.0f };
+				m_ColorFormats.push_back(specs[i].Format);
+			}
+			m_ClearValues.push_back(clear);
 		}
 
+		// Attachments are given when rendering begins, the pipelines only need their formats
+		if (VulkanCore::DynamicRendering())
+			return;
+
 		VkSubpassDescription subpass = {};
 		subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
 		subpass.inputAttachmentCount = 0;
 		subpass.pInputAttachments = nullptr;
-		subpass.colorAttachmentCount = 1;
+		subpass.colorAttachmentCount = colorRefs.size();
 		subpass.pResolveAttachments = nullptr;
 		// The index is the index in the glsl shader layout!
-		subpass.pColorAttachments = refs.data();
-		for (uint32_t i=0; i<refs.size(); i++)
-			if (refs[i].layout == VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL)
-				subpass.pDepthStencilAttachment = &refs[i];
+		subpass.pColorAttachments = colorRefs.data();
+		if (hasDepth)
+			subpass.pDepthStencilAttachment = &depthRef;
 		subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
 
 		VkRenderPassCreateInfo renderPassInfo = {};
@@ -59,12 +83,153 @@ namespace Low
 		vkDestroyRenderPass(VulkanCore::Device(), m_Handle, nullptr);
 	}
 
-	void RenderPass::Begin(Ref<GraphicsPipeline> pipeline, const glm::vec2& screenSize)
+	void RenderPass::Begin(Ref<GraphicsPipeline> pipeline, const glm::vec2& screenSize, VkSubpassContents contents)
+	{
+		Begin(*State::Framebuffer(), pipeline, screenSize, contents);
+	}
+
+	void RenderPass::Begin(Framebuffer& framebuffer, Ref<GraphicsPipeline> pipeline, const glm::vec2& screenSize, VkSubpassContents contents)
 	{
+		if (m_Handle == VK_NULL_HANDLE)
+		{
+			BeginRendering(framebuffer, screenSize, contents);
+			if (contents == VK_SUBPASS_CONTENTS_INLINE)
+			{
+				pipeline->Bind();
+				SetViewport(*State::CommandBuffer(), screenSize);
+			}
+			return;
+		}
+
 		VkRect2D renderArea;
 		renderArea.extent = { (uint32_t)screenSize.x, (uint32_t)screenSize.y };
 		renderArea.offset = { 0, 0 };
 
+		VkRenderPassBeginInfo renderPassInfo{};
+		renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+		renderPassInfo.renderPass = m_Handle;
+		renderPassInfo.framebuffer = framebuffer;
+		renderPassInfo.renderArea = renderArea;
+		renderPassInfo.clearValueCount = m_ClearValues.size();
+		renderPassInfo.pClearValues = m_ClearValues.data();
+
+		vkCmdBeginRenderPass(*State::CommandBuffer(), &renderPassInfo, contents);
+		if (contents == VK_SUBPASS_CONTENTS_INLINE)
+		{
+			pipeline->Bind();
+			SetViewport(*State::CommandBuffer(), screenSize);
+		}
+	}
+
+	void RenderPass::End()
+	{
+		if (m_Handle == VK_NULL_HANDLE)
+			EndRendering();
+		else
+			vkCmdEndRenderPass(*State::CommandBuffer());
+	}
+
+	void RenderPass::BeginRendering(Framebuffer& framebuffer, const glm::vec2& screenSize, VkSubpassContents contents)
+	{
+		VkCommandBuffer commandBuffer = *State::CommandBuffer();
+		const std::vector<FramebufferAttachment>& attachments = framebuffer.Attachments();
+		m_Current = &framebuffer;
+
+		// Same transitions and external dependency as the render pass objects: from the initial layout to the one used while
+		// rendering, once the previous attachment writes are done
+		std::vector<VkImageMemoryBarrier> barriers(m_Specs.size());
+		std::vector<VkRenderingAttachmentInfo> colorInfos;
+		VkRenderingAttachmentInfo depthInfo = {};
+		bool hasDepth = false;
+
+		for (uint32_t i = 0; i < m_Specs.size(); i++)
+		{
+			const FramebufferAttachmentSpecs& spec = m_Specs[i];
+			bool depth = spec.Type == AttachmentType::Depth;
+
+			VkImageMemoryBarrier& barrier = barriers[i];
+			barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+			barrier.srcAccessMask = 0;
+			barrier.dstAccessMask = depth ? VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT :
+				VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+			barrier.oldLayout = spec.Description.initialLayout;
+			barrier.newLayout = spec.Reference.layout;
+			barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+			barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+			barrier.image = attachments[i].Image;
+			barrier.subresourceRange = { (VkImageAspectFlags)(depth ? VK_IMAGE_ASPECT_DEPTH_BIT : VK_IMAGE_ASPECT_COLOR_BIT), 0, 1, 0, 1 };
+
+			VkRenderingAttachmentInfo info = {};
+			info.sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO;
+			info.imageView = attachments[i].ImageView;
+			info.imageLayout = spec.Reference.layout;
+			info.loadOp = spec.Description.loadOp;
+			info.storeOp = spec.Description.storeOp;
+			info.clearValue = m_ClearValues[i];
+
+			if (depth)
+			{
+				depthInfo = info;
+				hasDepth = true;
+			}
+			else
+				colorInfos.push_back(info);
+		}
+
+		VkPipelineStageFlags stages = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT |
+			VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+		vkCmdPipelineBarrier(commandBuffer, stages, stages, 0, 0, nullptr, 0, nullptr, barriers.size(), barriers.data());
+
+		VkRenderingInfo renderingInfo = {};
+		renderingInfo.sType = VK_STRUCTURE_TYPE_RENDERING_INFO;
+		renderingInfo.flags = contents == VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS ? VK_RENDERING_CONTENTS_SECONDARY_COMMAND_BUFFERS_BIT : 0;
+		renderingInfo.renderArea.offset = { 0, 0 };
+		renderingInfo.renderArea.extent = { (uint32_t)screenSize.x, (uint32_t)screenSize.y };
+		renderingInfo.layerCount = 1;
+		renderingInfo.colorAttachmentCount = colorInfos.size();
+		renderingInfo.pColorAttachments = colorInfos.data();
+		renderingInfo.pDepthAttachment = hasDepth ? &depthInfo : nullptr;
+
+		vkCmdBeginRendering(commandBuffer, &renderingInfo);
+	}
+
+	void RenderPass::EndRendering()
+	{
+		VkCommandBuffer commandBuffer = *State::CommandBuffer();
+		vkCmdEndRendering(commandBuffer);
+
+		// Only the attachments leaving the pass in another layout, such as presented swapchain images, need a transition
+		const std::vector<FramebufferAttachment>& attachments = m_Current->Attachments();
+		std::vector<VkImageMemoryBarrier> barriers;
+		for (uint32_t i = 0; i < m_Specs.size(); i++)
+		{
+			const FramebufferAttachmentSpecs& spec = m_Specs[i];
+			if (spec.Description.finalLayout == spec.Reference.layout)
+				continue;
+
+			bool depth = spec.Type == AttachmentType::Depth;
+
+			VkImageMemoryBarrier barrier = {};
+			barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+			barrier.srcAccessMask = depth ? VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT : VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+			barrier.dstAccessMask = 0;
+			barrier.oldLayout = spec.Reference.layout;
+			barrier.newLayout = spec.Description.finalLayout;
+			barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+			barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+			barrier.image = attachments[i].Image;
+			barrier.subresourceRange = { (VkImageAspectFlags)(depth ? VK_IMAGE_ASPECT_DEPTH_BIT : VK_IMAGE_ASPECT_COLOR_BIT), 0, 1, 0, 1 };
+			barriers.push_back(barrier);
+		}
+
+		if (!barriers.empty())
+			vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
+				VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, 0, nullptr, 0, nullptr, barriers.size(), barriers.data());
+		m_Current = nullptr;
+	}
+
+	void RenderPass::SetViewport(VkCommandBuffer commandBuffer, const glm::vec2& screenSize)
+	{
 		VkViewport viewport = {};
 		VkRect2D scissors = {};
 
@@ -75,31 +240,11 @@ namespace Low
 		viewport.minDepth = 0.0f;
 		viewport.maxDepth = 1.0f;
 
-		scissors.extent = renderArea.extent;
+		scissors.extent = { (uint32_t)screenSize.x, (uint32_t)screenSize.y };
 		scissors.offset.x = 0.0f;
 		scissors.offset.y = 0.0f;
 
-		std::array<VkClearValue, 2> clearColors;
-		clearColors[0].color = { 0.0f, 0.0f, 0.0f, 1.0f };
-		clearColors[1].depthStencil = { 1.0f, 0 };
-
-		VkRenderPassBeginInfo renderPassInfo{};
-		renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-		renderPassInfo.renderPass = m_Handle;
-		renderPassInfo.framebuffer = *State::Framebuffer();
-		renderPassInfo.renderArea = renderArea;
-		renderPassInfo.clearValueCount = clearColors.size();
-		renderPassInfo.pClearValues = clearColors.data();
-
-		vkCmdBeginRenderPass(*State::CommandBuffer(), &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
-		pipeline->Bind();
-
-		vkCmdSetViewport(*State::CommandBuffer(), 0, 1, &viewport);
-		vkCmdSetScissor(*State::CommandBuffer(), 0, 1, &scissors);
-	}
-
-	void RenderPass::End()
-	{
-		vkCmdEndRenderPass(*State::CommandBuffer());
+		vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+		vkCmdSetScissor(commandBuffer, 0, 1, &scissors);
 	}
 }
\ No newline at end of file
@@ -5,19 +5,45 @@ namespace Low
 	struct FramebufferAttachmentSpecs;
 
 	class GraphicsPipeline;
+	class Framebuffer;
 
+	// With VulkanCore::DynamicRendering no render pass object is created: Begin starts dynamic rendering on the views of the
+	// framebuffer, and does the layout transitions described by the specs itself
 	class RenderPass
 	{
 	public:
 		RenderPass(const std::vector<FramebufferAttachmentSpecs>& specs);
 		~RenderPass();
 
-		void Begin(Ref<GraphicsPipeline> pipeline, const glm::vec2& screenSize);
+		// With VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS the pipeline and the viewport aren't set: each secondary buffer
+		// has to bind them itself
+		void Begin(Ref<GraphicsPipeline> pipeline, const glm::vec2& screenSize, VkSubpassContents contents = VK_SUBPASS_CONTENTS_INLINE);
+		// Renders into the given framebuffer instead of the one bound to the State
+		void Begin(Framebuffer& framebuffer, Ref<GraphicsPipeline> pipeline, const glm::vec2& screenSize,
+			VkSubpassContents contents = VK_SUBPASS_CONTENTS_INLINE);
 		void End();
 
+		static void SetViewport(VkCommandBuffer commandBuffer, const glm::vec2& screenSize);
+
+		// VK_NULL_HANDLE with dynamic rendering
 		inline operator VkRenderPass() { return m_Handle; }
+		// Attachment formats, for the pipelines and the secondary buffers used without render pass objects
+		inline const std::vector<VkFormat>& ColorFormats() const { return m_ColorFormats; }
+		inline VkFormat DepthFormat() const { return m_DepthFormat; }
+
+	private:
+		void BeginRendering(Framebuffer& framebuffer, const glm::vec2& screenSize, VkSubpassContents contents);
+		void EndRendering();
 
 	private:
-		VkRenderPass m_Handle;
+		VkRenderPass m_Handle = VK_NULL_HANDLE;
+		std::vector<FramebufferAttachmentSpecs> m_Specs;
+		// One per attachment, in the order of the specs
+		std::vector<VkClearValue> m_ClearValues;
+
+		std::vector<VkFormat> m_ColorFormats;
+		VkFormat m_DepthFormat = VK_FORMAT_UNDEFINED;
+		// Framebuffer being rendered to with dynamic rendering, transitioned to the final layouts by End
+		Framebuffer* m_Current = nullptr;
 	};
 }
\ No newline at end of file
@@ -3,6 +3,7 @@
 #include <Core/Debug.h>
 #include <Vulkan/Queue.h>
 #include <Hardware/Support.h>
+#include <Hardware/Memory.h>
 
 #include <GLFW/glfw3.h>
 
@@ -15,8 +16,15 @@ namespace Low
 
 	Ref<Queue>			VulkanCore::s_GraphicsQueue = nullptr;
 	Ref<Queue>			VulkanCore::s_PresentQueue = nullptr;
+	Ref<Queue>			VulkanCore::s_TransferQueue = nullptr;
+	uint32_t			VulkanCore::s_GraphicsFamily = 0;
+	uint32_t			VulkanCore::s_TransferFamily = 0;
 	Ref<DescriptorPool>	VulkanCore::s_DescriptorPool = nullptr;
 
+	bool				VulkanCore::s_SupportsIndirectCount = false;
+	bool				VulkanCore::s_SupportsPipelineStatistics = false;
+	bool				VulkanCore::s_DynamicRendering = false;
+
 	VulkanCoreConfig	VulkanCore::s_Config = {};
 
 	void VulkanCore::Init(const VulkanCoreConfig& config)
@@ -27,12 +35,24 @@ namespace Low
 		CreateInstance();
 		Debug::InitMessengers(s_Instance);
 
-		if (glfwCreateWindowSurface(s_Instance, s_Config.WindowHandle, nullptr, 
-			&s_WindowSurface) != VK_SUCCESS)
-			throw std::runtime_error("failed to create window surface!");
+		if (s_Config.WindowHandle)
+		{
+			if (glfwCreateWindowSurface(s_Instance, s_Config.WindowHandle, nullptr, 
+				&s_WindowSurface) != VK_SUCCESS)
+				throw std::runtime_error("failed to create window surface!");
+		}
+		else
+		{
+			// Nothing to present to: software ICDs on display-less machines don't have to support swapchains
+			auto swapchainExt = std::find_if(s_Config.LowExtensions.begin(), s_Config.LowExtensions.end(),
+				[](const char* ext) { return std::string(ext) == VK_KHR_SWAPCHAIN_EXTENSION_NAME; });
+			if (swapchainExt != s_Config.LowExtensions.end())
+				s_Config.LowExtensions.erase(swapchainExt);
+		}
 
 		PickPhysicalDevice();
 		CreateLogicalDevice();
+		Memory::Init(s_Device, s_PhysicalDevice);
 
 		s_DescriptorPool = CreateRef<Low::DescriptorPool>(s_Config.MaxFramesInFlight);
 	}
@@ -84,6 +104,8 @@ namespace Low
 
 		std::vector<VkDeviceQueueCreateInfo> queueCreateInfo;
 		std::set<uint32_t> queueFamilies = { indices.Graphics.value(), indices.Presentation.value() };
+		if (indices.Transfer.has_value())
+			queueFamilies.insert(indices.Transfer.value());
 
 		VkDeviceCreateInfo createInfo = {};
 
@@ -99,10 +121,51 @@ namespace Low
 			queueCreateInfo.push_back(queueInfo);
 		}
 
+		// Indirect drawing features are optional: enable them only if they're there. The 1.3 features can only be queried
+		// from 1.3 devices
+		VkPhysicalDeviceProperties properties;
+		vkGetPhysicalDeviceProperties(PhysicalDevice(), &properties);
+		bool vulkan13 = properties.apiVersion >= VK_API_VERSION_1_3;
+
+		VkPhysicalDeviceVulkan13Features supported13 = {};
+		supported13.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_3_FEATURES;
+		VkPhysicalDeviceVulkan12Features supported12 = {};
+		supported12.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+		supported12.pNext = vulkan13 ? &supported13 : nullptr;
+		VkPhysicalDeviceFeatures2 supported = {};
+		supported.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+		supported.pNext = &supported12;
+		vkGetPhysicalDeviceFeatures2(PhysicalDevice(), &supported);
+
+		s_SupportsIndirectCount = supported12.drawIndirectCount && supported.features.multiDrawIndirect &&
+			supported.features.drawIndirectFirstInstance;
+		// Statistics of the geometry pass are collected around secondary buffers, which have to inherit the query
+		s_SupportsPipelineStatistics = supported.features.pipelineStatisticsQuery && supported.features.inheritedQueries;
+
+		s_DynamicRendering = s_Config.DynamicRendering && vulkan13 && supported13.dynamicRendering;
+		// Frames are tracked with a timeline semaphore, core since 1.2
+		if (!supported12.timelineSemaphore)
+			throw std::runtime_error("The device doesn't support timeline semaphores");
+
+		VkPhysicalDeviceVulkan13Features features13 = {};
+		features13.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_3_FEATURES;
+		features13.dynamicRendering = s_DynamicRendering;
+
+		VkPhysicalDeviceVulkan12Features features12 = {};
+		features12.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+		features12.drawIndirectCount = s_SupportsIndirectCount;
+		features12.timelineSemaphore = VK_TRUE;
+		features12.pNext = vulkan13 ? &features13 : nullptr;
+
 		VkPhysicalDeviceFeatures deviceFeatures = {};
 		deviceFeatures.samplerAnisotropy = VK_TRUE;
+		deviceFeatures.multiDrawIndirect = s_SupportsIndirectCount;
+		deviceFeatures.drawIndirectFirstInstance = s_SupportsIndirectCount;
+		deviceFeatures.pipelineStatisticsQuery = s_SupportsPipelineStatistics;
+		deviceFeatures.inheritedQueries = s_SupportsPipelineStatistics;
 
 		createInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+		createInfo.pNext = &features12;
 		createInfo.pQueueCreateInfos = queueCreateInfo.data();
 		createInfo.queueCreateInfoCount = queueCreateInfo.size();
 		createInfo.pEnabledFeatures = &deviceFeatures;
@@ -129,6 +192,15 @@ namespace Low
 
 		s_GraphicsQueue = CreateRef<Queue>(graphics, Queue::QueueType::Graphics);
 		s_PresentQueue = CreateRef<Queue>(graphics, Queue::QueueType::Present);
+		s_GraphicsFamily = indices.Graphics.value();
+
+		if (indices.Transfer.has_value())
+		{
+			VkQueue transfer;
+			vkGetDeviceQueue(Device(), indices.Transfer.value(), 0, &transfer);
+			s_TransferQueue = CreateRef<Queue>(transfer, Queue::QueueType::Transfer);
+			s_TransferFamily = indices.Transfer.value();
+		}
 	}
 
 	void VulkanCore::PickPhysicalDevice()
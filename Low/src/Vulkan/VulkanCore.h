@@ -9,8 +9,12 @@ namespace Low
 		std::vector<const char*> UserExtensions;
 		std::vector<const char*> LowExtensions = { VK_KHR_SWAPCHAIN_EXTENSION_NAME };
 
-		GLFWwindow* WindowHandle;
+		// nullptr for headless rendering: no surface is created and swapchain support isn't required
+		GLFWwindow* WindowHandle = nullptr;
 		uint32_t MaxFramesInFlight;
+
+		// Enabled only if the device supports it, see VulkanCore::DynamicRendering
+		bool DynamicRendering = false;
 	};
 
 	class Queue;
@@ -22,13 +26,27 @@ namespace Low
 		static inline VkInstance Instance() { return s_Instance; }
 		static inline VkDevice Device() { return s_Device; }
 		static inline VkPhysicalDevice PhysicalDevice() { return s_PhysicalDevice; }
+		// VK_NULL_HANDLE when headless
 		static inline VkSurfaceKHR Surface() { return s_WindowSurface; }
+		static inline bool Headless() { return s_WindowSurface == VK_NULL_HANDLE; }
 		
 		static inline Ref<Queue> GraphicsQueue() { return s_GraphicsQueue; }
 		static inline Ref<Queue> PresentQueue() { return s_PresentQueue; }
+		// Transfer only queue, nullptr if the device doesn't have one
+		static inline Ref<Queue> TransferQueue() { return s_TransferQueue; }
+		static inline uint32_t GraphicsFamily() { return s_GraphicsFamily; }
+		static inline uint32_t TransferFamily() { return s_TransferFamily; }
 
 		static inline Ref<Low::DescriptorPool> DescriptorPool() { return s_DescriptorPool; }
 
+		// Multi draw indirect with a GPU written draw count, required by the GPU driven renderer
+		static inline bool SupportsIndirectCount() { return s_SupportsIndirectCount; }
+		// Pipeline statistics queries, including ones active while secondary buffers are executed
+		static inline bool SupportsPipelineStatistics() { return s_SupportsPipelineStatistics; }
+		// Render passes begin with vkCmdBeginRendering on image views instead of render pass and framebuffer objects. Requested
+		// in the config and supported by the device (Vulkan 1.3)
+		static inline bool DynamicRendering() { return s_DynamicRendering; }
+
 		static void Init(const VulkanCoreConfig& config);
 
 	private:
@@ -44,8 +62,15 @@ namespace Low
 
 		static Ref<Queue> s_GraphicsQueue;
 		static Ref<Queue> s_PresentQueue;
+		static Ref<Queue> s_TransferQueue;
+		static uint32_t s_GraphicsFamily;
+		static uint32_t s_TransferFamily;
 		static Ref<Low::DescriptorPool> s_DescriptorPool;
 
+		static bool s_SupportsIndirectCount;
+		static bool s_SupportsPipelineStatistics;
+		static bool s_DynamicRendering;
+
 		static VulkanCoreConfig s_Config;
 	};
 }
\ No newline at end of file
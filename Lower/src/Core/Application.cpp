@@ -143,6 +143,8 @@ namespace Lower
         config.ExtensionCount = extensionCount;
         config.Extensions = extensions.data();
         config.MaxFramesInFlight = 2;
+        // Run keeps polling events and updating the scene while the previous frame is drawn
+        config.RenderThread = true;
 
         Low::Renderer::Init(config, m_WindowHandle);
     }
@@ -161,17 +163,39 @@ namespace Lower
 
         m_Meshes.push_back(CreateRef<Mesh>("../../Assets/Models/Sphere/sphere.obj"));
         m_Materials.push_back(CreateRef<MaterialInstance>());
+
+        m_Renderables.push_back(Renderer::AddRenderable(m_Meshes[0], m_Materials[0], glm::mat4(1.0f)));
 	}
 
 	void Application::Run()
 	{
+        double lastStatsTime = glfwGetTime();
+
         while (!glfwWindowShouldClose(m_WindowHandle)) 
         {
             glfwPollEvents();
 
+            // Transforms are uploaded per object now: spin the sphere like the old hard-coded model matrix did
+            float time = glfwGetTime();
+            Low::Renderer::UpdateTransform(m_Renderables[0], glm::rotate(glm::mat4(1.0f), time * 0.75f * glm::radians(90.0f), glm::vec3(0.0f, 1.0f, 0.0f)));
+
             Low::Renderer::Begin(m_Camera);
-            Renderer::PushModel(m_Meshes[0], m_Materials[0], glm::mat4(1.0f));
+            // The light that used to be hard-coded in the shader
+            Low::Renderer::PushLight({ glm::vec3(4.0f, 4.0f, 3.0f), glm::vec3(23.47f, 21.31f, 20.79f), 50.0f });
             Low::Renderer::End();
+
+            // Report the culling results once per second
+            if (glfwGetTime() - lastStatsTime >= 1.0)
+            {
+                Low::RendererStats stats = Low::Renderer::Stats();
+                std::stringstream title;
+                title << m_Name << " - visible: " << stats.VisibleRenderables << ", culled: " << stats.CulledRenderables << ", draws: " << stats.DrawCalls <<
+                    ", culling: " << stats.CullingTime << " ms, sorting: " << stats.SortingTime << " ms, recording: " <<
+                    stats.RecordingTime << " ms";
+
+                glfwSetWindowTitle(m_WindowHandle, title.str().c_str());
+                lastStatsTime = glfwGetTime();
+            }
         }
 
         Stop();
@@ -179,9 +203,10 @@ namespace Lower
 
     void Application::Stop()
     {
+        // The renderer may still be presenting to the window until it's destroyed
+        Low::Renderer::Destroy();
+
         glfwDestroyWindow(m_WindowHandle);
         glfwTerminate();
-
-        Low::Renderer::Destroy();
     }
 }
\ No newline at end of file
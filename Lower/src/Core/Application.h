@@ -4,6 +4,7 @@
 #include <Resources/Camera.h>
 #include <Resources/Mesh.h>
 #include <Resources/MaterialInstance.h>
+#include <Rendering/RenderableRegistry.h>
 
 #include <string>
 #include <vector>
@@ -42,6 +43,7 @@ namespace Lower
 		Camera m_Camera;
 		std::vector<Ref<Mesh>> m_Meshes;
 		std::vector<Ref<MaterialInstance>> m_Materials;
+		std::vector<RenderableHandle> m_Renderables;
 
 		static Application* s_Application;
 	};